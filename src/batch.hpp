@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include "iso8601.hpp"
+
+namespace parser {
+
+struct range_t {
+    const char* begin;
+    const char* end;
+};
+
+// struct-of-arrays output, row i of the input goes to slot i of every column;
+// ok/utc are bitmaps, bit (i % 64) of word (i / 64)
+struct columns_t {
+    int32_t*    year;
+    uint32_t*   mon;
+    uint32_t*   mday;
+    uint32_t*   hour;
+    uint32_t*   min;
+    uint32_t*   sec;
+    microsec_t* mksec;
+    int32_t*    tz_offset;                                  // minutes east of UTC
+    uint64_t*   ok;                                         // row parsed completely
+    uint64_t*   utc;                                        // row carried Z or an explicit offset
+};
+
+template <typename G>
+struct batch {
+    // parses every range, returns the number of rows parsed completely
+    static inline std::size_t parse(const range_t* rows, std::size_t count, columns_t& out) {
+        std::size_t parsed = 0;
+        for (std::size_t word = 0; word * 64 < count; ++word) {
+            const std::size_t base = word * 64;
+            const std::size_t n = std::min<std::size_t>(64, count - base);
+            uint64_t ok_bits = 0, utc_bits = 0;
+            for (std::size_t bit = 0; bit < n; ++bit) {
+                const range_t& r = rows[base + bit];
+                row(r.begin, r.end, base + bit, bit, out, ok_bits, utc_bits);
+            }
+            out.ok[word] = ok_bits;
+            out.utc[word] = utc_bits;
+            parsed += __builtin_popcountll(ok_bits);
+        }
+        return parsed;
+    }
+
+    // parses a delim-separated buffer, up to capacity rows; a trailing delimiter
+    // does not start an empty row. Returns the number of rows written to out.
+    static inline std::size_t parse(const char* ptr, const char* ptr_end, char delim, columns_t& out, std::size_t capacity) {
+        std::size_t count = 0;
+        uint64_t ok_bits = 0, utc_bits = 0;
+        while (ptr < ptr_end && count < capacity) {
+            const char* row_end = static_cast<const char*>(std::memchr(ptr, delim, ptr_end - ptr));
+            if (!row_end) row_end = ptr_end;
+            const std::size_t bit = count % 64;
+            row(ptr, row_end, count, bit, out, ok_bits, utc_bits);
+            if (bit == 63) {
+                out.ok[count / 64] = ok_bits;
+                out.utc[count / 64] = utc_bits;
+                ok_bits = utc_bits = 0;
+            }
+            ++count;
+            ptr = row_end + 1;
+        }
+        if (count % 64) {
+            out.ok[count / 64] = ok_bits;
+            out.utc[count / 64] = utc_bits;
+        }
+        return count;
+    }
+
+private:
+    // all columns are written unconditionally, failed rows keep whatever the grammar reached
+    static inline void row(const char* ptr, const char* ptr_end, std::size_t i, std::size_t bit,
+                           columns_t& out, uint64_t& ok_bits, uint64_t& utc_bits) {
+        value_context_t ctx = value_context_t::local();
+        const char* result = G::parse(ptr, ptr_end, ctx);
+        const datetime& dt = ctx.dt;
+        const timezone_t& tz = ctx.tz;
+        out.year[i] = dt.year;
+        out.mon[i] = dt.mon;
+        out.mday[i] = dt.mday;
+        out.hour[i] = dt.hour;
+        out.min[i] = dt.min;
+        out.sec[i] = dt.sec;
+        out.mksec[i] = ctx.mksec;
+        out.tz_offset[i] = tz.sign * static_cast<int32_t>(tz.hour * 60 + tz.minute);
+        ok_bits |= static_cast<uint64_t>(result == ptr_end) << bit;
+        utc_bits |= static_cast<uint64_t>(tz.tz_info == tz_info_t::UTC) << bit;
+    }
+};
+
+}
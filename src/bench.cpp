@@ -0,0 +1,845 @@
+// lazy-stingization-bench: every grammar over randomized corpora of its own
+// shapes, the formatters over random values, and the libc/iostream baselines
+// (strptime, std::get_time, sscanf, strftime, mktime) on the same rows; also
+// the context types, traced grammars, views, zones and the parallel batch
+// parser over 1 to hardware_concurrency threads. Reports the
+// best of --trials runs as ns/op and MB/s of input (parsers) or output
+// (formatters), plus cycles, instructions and branch misses per op where
+// perf_event_open is allowed.
+//
+//   lazy-stingization-bench [--rows=N] [--trials=N] [--seed=N] [filter...]
+//
+// A benchmark runs when its name contains one of the filters, all by default.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "iso8601.hpp"
+#include "fast_path.hpp"
+#include "flat.hpp"
+#include "validate.hpp"
+#include "epoch.hpp"
+#include "formatter.hpp"
+#include "format_batch.hpp"
+#include "pattern.hpp"
+#include "literal.hpp"
+#include "keyword.hpp"
+#include "memo.hpp"
+#include "detect.hpp"
+#include "column.hpp"
+#include "parallel.hpp"
+#include "zone.hpp"
+#include "view.hpp"
+#include "trace.hpp"
+
+namespace {
+
+constexpr char generic_format[] = "%F %T";
+
+struct options_t {
+    std::size_t rows = 1 << 16;
+    int trials = 5;
+    uint64_t seed = 42;
+    std::vector<std::string> filters;
+};
+
+// xorshift64*, the corpora only have to be the same from run to run
+struct rng_t {
+    uint64_t state;
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+    uint32_t below(uint32_t n) { return static_cast<uint32_t>(next() % n); }
+    uint32_t in(uint32_t lo, uint32_t hi) { return lo + below(hi - lo + 1); }
+};
+
+// NUL separated rows in one buffer, so that the C baselines see C strings
+struct corpus_t {
+    std::string bytes;
+    std::vector<std::size_t> offsets;
+    std::vector<std::size_t> lengths;
+
+    template <typename F>
+    static corpus_t make(const options_t& opt, uint64_t salt, F&& row) {
+        rng_t rng {opt.seed * 0x9E3779B97F4A7C15ull + salt};
+        corpus_t c;
+        char buff[128];
+        for (std::size_t i = 0; i < opt.rows; ++i) {
+            const int n = row(rng, buff);
+            c.offsets.push_back(c.bytes.size());
+            c.lengths.push_back(n);
+            c.bytes.append(buff, n);
+            c.bytes.push_back('\0');
+        }
+        return c;
+    }
+
+    std::size_t size() const { return offsets.size(); }
+    const char* row(std::size_t i) const { return bytes.data() + offsets[i]; }
+    std::size_t payload() const { return bytes.size() - offsets.size(); }
+};
+
+int fraction(rng_t& rng, char* out) {
+    const int digits = rng.in(1, 9);
+    out[0] = rng.below(4) ? '.' : ',';
+    for (int i = 1; i <= digits; ++i) out[i] = static_cast<char>('0' + rng.below(10));
+    return digits + 1;
+}
+
+// ±HH, ±HHMM, ±HH:MM and, when utc, Z
+int tz_offset(rng_t& rng, char* out, bool utc) {
+    const char sign = rng.below(2) ? '+' : '-';
+    const unsigned h = rng.below(15), m = rng.below(4) * 15;
+    switch (rng.below(4)) {
+        case 0: if (utc) return std::sprintf(out, "Z");
+        // fall through
+        case 1: return std::sprintf(out, "%c%02u", sign, h);
+        case 2: return std::sprintf(out, "%c%02u%02u", sign, h, m);
+        default: return std::sprintf(out, "%c%02u:%02u", sign, h, m);
+    }
+}
+
+// every shape of grammar_date
+int date_row(rng_t& rng, char* out) {
+    const unsigned y = rng.in(1900, 2100), m = rng.in(1, 12), d = rng.in(1, 28), w = rng.in(1, 52), wd = rng.in(1, 7), o = rng.in(1, 365);
+    switch (rng.below(10)) {
+        case 0: return std::sprintf(out, "%04u", y);
+        case 1: return std::sprintf(out, "%04u%02u%02u", y, m, d);
+        case 2: return std::sprintf(out, "%04u-%02u", y, m);
+        case 3: return std::sprintf(out, "%04u-%03u", y, o);
+        case 4: return std::sprintf(out, "%04u%03u", y, o);
+        case 5: return std::sprintf(out, "%04uW%02u", y, w);
+        case 6: return std::sprintf(out, "%04uW%02u%u", y, w, wd);
+        case 7: return std::sprintf(out, "%04u-W%02u", y, w);
+        case 8: return std::sprintf(out, "%04u-W%02u-%u", y, w, wd);
+        default: return std::sprintf(out, "%04u-%02u-%02u", y, m, d);
+    }
+}
+
+// grammar_iso8601 date and time, extended or basic, fractions of any unit
+int time_row(rng_t& rng, char* out) {
+    const unsigned y = rng.in(1970, 2038), mo = rng.in(1, 12), d = rng.in(1, 28), h = rng.below(24), mi = rng.below(60), s = rng.below(60);
+    int n;
+    switch (rng.below(5)) {
+        case 0: n = std::sprintf(out, "%04u%02u%02uT%02u%02u", y, mo, d, h, mi); break;
+        case 1: n = std::sprintf(out, "%04u-%02u-%02uT%02u:%02u", y, mo, d, h, mi); break;
+        case 2: n = std::sprintf(out, "%04u-%02u-%02uT%02u", y, mo, d, h); break;
+        default: n = std::sprintf(out, "%04u-%02u-%02uT%02u:%02u:%02u", y, mo, d, h, mi, s); break;
+    }
+    return n + fraction(rng, out + n);
+}
+
+int tz_row(rng_t& rng, char* out) {
+    const unsigned y = rng.in(1970, 2038), mo = rng.in(1, 12), d = rng.in(1, 28), h = rng.below(24), mi = rng.below(60), s = rng.below(60);
+    int n = std::sprintf(out, "%04u-%02u-%02uT%02u:%02u:%02u", y, mo, d, h, mi, s);
+    if (rng.below(2)) n += fraction(rng, out + n);
+    return n + tz_offset(rng, out + n, true);
+}
+
+int vcard_row(rng_t& rng, char* out) {
+    if (rng.below(2)) return std::sprintf(out, "--%02u%02u", rng.in(1, 12), rng.in(1, 28));
+    return std::sprintf(out, "---%02u", rng.in(1, 28));
+}
+
+// grammar_generic with signed years of 1 to 9 digits
+int large_year_row(rng_t& rng, char* out) {
+    static const uint32_t limits[] = {9, 99, 999, 9999, 99999, 999999, 9999999, 99999999, 999999999};
+    const char* sign = rng.below(3) == 0 ? "-" : rng.below(2) ? "+" : "";
+    return std::sprintf(out, "%s%u-%02u-%02u %02u:%02u:%02u", sign, rng.in(1, limits[rng.below(9)]),
+                        rng.in(1, 12), rng.in(1, 28), rng.below(24), rng.below(60), rng.below(60));
+}
+
+// the log lines: grammar_generic, mostly the canonical layout
+int generic_row(rng_t& rng, char* out) {
+    const unsigned y = rng.in(1970, 2038), mo = rng.in(1, 12), d = rng.in(1, 28), h = rng.below(24), mi = rng.below(60), s = rng.below(60);
+    const char sep = rng.below(8) ? '-' : '/';
+    int n = std::sprintf(out, "%04u%c%02u%c%02u %02u:%02u:%02u", y, sep, mo, sep, d, h, mi, s);
+    if (rng.below(4) == 0) n += std::sprintf(out + n, ".%06u", rng.below(1000000));
+    if (rng.below(4) == 0) n += tz_offset(rng, out + n, false);
+    return n;
+}
+
+// a log in time order: 0 to 3 seconds between the lines, so whole days and
+// hours share their prefix
+struct log_rows {
+    int64_t t = 1362504000;                         // 2013-03-05 17:20:00 UTC
+
+    int operator()(rng_t& rng, char* out) {
+        t += rng.below(4);
+        const time_t tt = static_cast<time_t>(t);
+        std::tm tm {};
+        gmtime_r(&tt, &tm);
+        int n = std::sprintf(out, "%04d-%02d-%02d %02d:%02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                             tm.tm_hour, tm.tm_min, tm.tm_sec);
+        if (rng.below(2)) n += std::sprintf(out + n, ".%06u", rng.below(1000000));
+        return n;
+    }
+};
+
+// generic rows with a byte changed, cut short or replaced by noise
+int invalid_row(rng_t& rng, char* out) {
+    int n = generic_row(rng, out);
+    switch (rng.below(3)) {
+        case 0: out[rng.below(n)] = static_cast<char>(rng.in(' ', '~')); break;
+        case 1: n = rng.in(1, n - 1); break;
+        default:
+            n = rng.in(1, 30);
+            for (int i = 0; i < n; ++i) out[i] = static_cast<char>(rng.in(' ', '~'));
+    }
+    return n;
+}
+
+const char* const month_abbr[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+const char* const week_day_abbr[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+const char* const zone_abbr[] = {"GMT", "UTC", "EST", "EDT", "CST", "CDT", "MST", "MDT", "PST", "PDT"};
+
+// Tue, 15 Nov 1994 08:12:31 GMT, the weekday does not have to match the date
+int http_date_row(rng_t& rng, char* out) {
+    return std::sprintf(out, "%s, %02u %s %04u %02u:%02u:%02u GMT", week_day_abbr[rng.below(7)], rng.in(1, 28),
+                        month_abbr[rng.below(12)], rng.in(1970, 2038), rng.below(24), rng.below(60), rng.below(60));
+}
+
+// [Tue, ]5 Nov 1994 08:12[:31] (EST|-0500)
+int rfc2822_row(rng_t& rng, char* out) {
+    int n = rng.below(4) ? std::sprintf(out, "%s, ", week_day_abbr[rng.below(7)]) : 0;
+    n += std::sprintf(out + n, "%u %s %04u %02u:%02u", rng.in(1, 28), month_abbr[rng.below(12)], rng.in(1970, 2038), rng.below(24), rng.below(60));
+    if (rng.below(4)) n += std::sprintf(out + n, ":%02u", rng.below(60));
+    if (rng.below(2)) return n + std::sprintf(out + n, " %s", zone_abbr[rng.below(10)]);
+    return n + std::sprintf(out + n, " %c%02u%02u", rng.below(2) ? '+' : '-', rng.below(15), rng.below(4) * 15);
+}
+
+// Oct  1 22:14:15
+int syslog_row(rng_t& rng, char* out) {
+    return std::sprintf(out, "%s %2u %02u:%02u:%02u", month_abbr[rng.below(12)], rng.in(1, 28), rng.below(24), rng.below(60), rng.below(60));
+}
+
+// "YYYY-MM-DD HH:MM:SS", the one layout every baseline parses
+int fixed_row(rng_t& rng, char* out) {
+    return std::sprintf(out, "%04u-%02u-%02u %02u:%02u:%02u", rng.in(1970, 2038), rng.in(1, 12), rng.in(1, 28),
+                        rng.below(24), rng.below(60), rng.below(60));
+}
+
+// one ISO layout with a zone, 1 row in 50 without the fraction
+int iso_log_row(rng_t& rng, char* out) {
+    int n = std::sprintf(out, "%04u-%02u-%02uT%02u:%02u:%02u", rng.in(1970, 2038), rng.in(1, 12), rng.in(1, 28),
+                         rng.below(24), rng.below(60), rng.below(60));
+    if (rng.below(50)) n += std::sprintf(out + n, ".%06u", rng.below(1000000));
+    return n + std::sprintf(out + n, "Z");
+}
+
+// "YYYY-MM-DDThh:mm:ss.ffffffZ" over 2000-2039, the canonical layout of view_t
+int canonical_row(rng_t& rng, char* out) {
+    return std::sprintf(out, "%04u-%02u-%02uT%02u:%02u:%02u.%06uZ", rng.in(2000, 2039), rng.in(1, 12), rng.in(1, 28),
+                        rng.below(24), rng.below(60), rng.below(60), rng.below(1000000));
+}
+
+// cycles, instructions and branch misses of this thread, user space only; the
+// events which can not be opened are reported as missing
+struct counters_t {
+    static const int count = 3;
+    int fds[count];
+    int opened = 0;
+
+    counters_t() {
+#if defined(__linux__)
+        static const uint64_t configs[count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < count; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            opened += fds[i] >= 0;
+        }
+#else
+        for (int i = 0; i < count; ++i) fds[i] = -1;
+#endif
+    }
+
+    ~counters_t() {
+#if defined(__linux__)
+        for (int fd : fds) if (fd >= 0) close(fd);
+#endif
+    }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // -1 for the missing events
+    void stop(int64_t (&values)[count]) {
+        for (int i = 0; i < count; ++i) {
+            values[i] = -1;
+#if defined(__linux__)
+            uint64_t value;
+            if (fds[i] >= 0 && ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0) == 0
+                && read(fds[i], &value, sizeof(value)) == sizeof(value)) values[i] = static_cast<int64_t>(value);
+#endif
+        }
+    }
+};
+
+volatile std::size_t sink;
+
+class runner_t {
+public:
+    explicit runner_t(const options_t& opt): opt(opt) {
+        std::printf("%-52s %10s %10s %10s %10s %10s %8s\n", "benchmark", "ns/op", "MB/s", "cycles/op", "instr/op", "miss/op", "ok %");
+        if (!counters.opened) std::printf("(hardware counters unavailable: perf_event_open not permitted)\n");
+    }
+
+    // fn(i) runs op i of ops and returns non-zero when it succeeded; bytes is the
+    // input or output of all ops, the rounds are repeated for 50 ms at least
+    template <typename F>
+    void run(const std::string& name, std::size_t ops, std::size_t bytes, F&& fn) {
+        if (!selected(name)) return;
+        std::size_t ok = 0;
+        for (std::size_t i = 0; i < ops; ++i) ok += fn(i) != 0;
+        std::size_t rounds = 1;
+        for (;;) {
+            const double spent = round(ops, rounds, fn);
+            if (spent >= 0.05e9) break;
+            rounds = std::max(rounds * 2, static_cast<std::size_t>(rounds * 0.06e9 / std::max(spent, 1.0)));
+        }
+        double best = 1e300;
+        int64_t best_counters[counters_t::count] = {-1, -1, -1};
+        for (int t = 0; t < opt.trials; ++t) {
+            counters.start();
+            const double spent = round(ops, rounds, fn);
+            int64_t values[counters_t::count];
+            counters.stop(values);
+            if (spent < best) {
+                best = spent;
+                std::copy(values, values + counters_t::count, best_counters);
+            }
+        }
+        const double total = static_cast<double>(ops) * rounds;
+        std::printf("%-52s %10.2f %10.1f", name.c_str(), best / total, bytes * rounds / (best / 1e9) / 1e6);
+        for (int64_t value : best_counters) {
+            if (value < 0) std::printf(" %10s", "-");
+            else std::printf(" %10.2f", value / total);
+        }
+        std::printf(" %8.1f\n", 100.0 * ok / std::max<std::size_t>(ops, 1));
+        std::fflush(stdout);
+    }
+
+    bool selected(const std::string& name) const {
+        if (opt.filters.empty()) return true;
+        for (const auto& f : opt.filters) if (name.find(f) != std::string::npos) return true;
+        return false;
+    }
+
+private:
+    template <typename F>
+    static double round(std::size_t ops, std::size_t rounds, F& fn) {
+        std::size_t local = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (std::size_t i = 0; i < ops; ++i) local += fn(i);
+        }
+        const std::chrono::duration<double, std::nano> spent = std::chrono::steady_clock::now() - t0;
+        sink = sink + local;
+        return spent.count();
+    }
+
+    const options_t& opt;
+    counters_t counters;
+};
+
+// complete matches count as ok; the sum of a field keeps the handlers alive
+template <typename G>
+void parse(runner_t& runner, const std::string& name, const corpus_t& c) {
+    runner.run(name, c.size(), c.payload(), [&c](std::size_t i) -> std::size_t {
+        parser::value_context_t ctx = parser::value_context_t::local();
+        const char* row = c.row(i);
+        const char* end = row + c.lengths[i];
+        return G::parse(row, end, ctx) == end ? 1 + ctx.dt.mday : 0;
+    });
+}
+
+// the same through one cached_grammar_t, which keeps its prefix across the
+// rows and the rounds
+template <typename G>
+void parse_cached(runner_t& runner, const std::string& name, const corpus_t& c) {
+    parser::cached_grammar_t<G> cached;
+    runner.run(name, c.size(), c.payload(), [&c, &cached](std::size_t i) -> std::size_t {
+        parser::value_context_t ctx = parser::value_context_t::local();
+        const char* row = c.row(i);
+        const char* end = row + c.lengths[i];
+        return cached.parse(row, end, ctx) == end ? 1 + ctx.dt.mday : 0;
+    });
+}
+
+void parsers(runner_t& runner, const options_t& opt) {
+    const corpus_t date = corpus_t::make(opt, 1, date_row);
+    const corpus_t time = corpus_t::make(opt, 2, time_row);
+    const corpus_t tz = corpus_t::make(opt, 3, tz_row);
+    const corpus_t vcard = corpus_t::make(opt, 4, vcard_row);
+    const corpus_t large = corpus_t::make(opt, 5, large_year_row);
+    const corpus_t generic = corpus_t::make(opt, 6, generic_row);
+    const corpus_t invalid = corpus_t::make(opt, 7, invalid_row);
+
+    parse<parser::grammar_date>(runner, "parse/date/grammar_date", date);
+    parse<parser::flat<parser::grammar_date>>(runner, "parse/date/flat<grammar_date>", date);
+    parse<parser::validated<parser::grammar_date>>(runner, "parse/date/validated<grammar_date>", date);
+    parse<parser::grammar_iso8601>(runner, "parse/time_fraction/grammar_iso8601", time);
+    parse<parser::flat<parser::grammar_iso8601>>(runner, "parse/time_fraction/flat<grammar_iso8601>", time);
+    parse<parser::grammar_iso8601>(runner, "parse/tz_offset/grammar_iso8601", tz);
+    parse<parser::validated<parser::grammar_iso8601>>(runner, "parse/tz_offset/validated<grammar_iso8601>", tz);
+    parse<parser::grammar_vCard>(runner, "parse/vcard/grammar_vCard", vcard);
+    parse<parser::grammar_iso8601>(runner, "parse/vcard/grammar_iso8601", vcard);
+    parse<parser::grammar_generic>(runner, "parse/large_year/grammar_generic", large);
+    parse<parser::grammar_generic>(runner, "parse/generic/grammar_generic", generic);
+    parse<parser::grammar_generic_fast>(runner, "parse/generic/grammar_generic_fast", generic);
+    parse<parser::flat<parser::grammar_generic>>(runner, "parse/generic/flat<grammar_generic>", generic);
+    parse_cached<parser::grammar_generic>(runner, "parse/generic/cached_grammar_t<grammar_generic>", generic);
+    parse<parser::grammar_generic>(runner, "parse/invalid/grammar_generic", invalid);
+    parse<parser::validated<parser::grammar_generic>>(runner, "parse/invalid/validated<grammar_generic>", invalid);
+
+    const corpus_t log = corpus_t::make(opt, 9, log_rows());
+    parse<parser::grammar_generic>(runner, "parse/sorted_log/grammar_generic", log);
+    parse<parser::grammar_generic_fast>(runner, "parse/sorted_log/grammar_generic_fast", log);
+    parse_cached<parser::grammar_generic>(runner, "parse/sorted_log/cached_grammar_t<grammar_generic>", log);
+    parse<parser::validated<parser::grammar_generic>>(runner, "parse/sorted_log/validated<grammar_generic>", log);
+    parse_cached<parser::validated<parser::grammar_generic>>(runner, "parse/sorted_log/cached_grammar_t<validated<grammar_generic>>", log);
+
+    const corpus_t http = corpus_t::make(opt, 10, http_date_row);
+    const corpus_t rfc2822 = corpus_t::make(opt, 11, rfc2822_row);
+    const corpus_t syslog = corpus_t::make(opt, 12, syslog_row);
+    parse<parser::grammar_http_date>(runner, "parse/http_date/grammar_http_date", http);
+    parse<parser::grammar_rfc2822>(runner, "parse/http_date/grammar_rfc2822", http);
+    runner.run("parse/http_date/baseline/strptime", http.size(), http.payload(), [&](std::size_t i) -> std::size_t {
+        std::tm tm {};
+        return strptime(http.row(i), "%a, %d %b %Y %H:%M:%S GMT", &tm) ? 1 + tm.tm_mday : 0;
+    });
+    parse<parser::grammar_rfc2822>(runner, "parse/rfc2822/grammar_rfc2822", rfc2822);
+    parse<parser::grammar_syslog>(runner, "parse/syslog/grammar_syslog", syslog);
+    runner.run("parse/syslog/baseline/strptime", syslog.size(), syslog.payload(), [&](std::size_t i) -> std::size_t {
+        std::tm tm {};
+        return strptime(syslog.row(i), "%b %e %H:%M:%S", &tm) ? 1 + tm.tm_mday : 0;
+    });
+}
+
+// one grammar into the three context types: references, values and bit-fields
+void contexts(runner_t& runner, const options_t& opt) {
+    using G = parser::validated<parser::grammar_generic>;
+    const corpus_t c = corpus_t::make(opt, 6, generic_row);
+    runner.run("context/generic/context_t", c.size(), c.payload(), [&c](std::size_t i) -> std::size_t {
+        datetime dt {0, 0, 0, 0, 0, 0};
+        parser::microsec_t mksec {0};
+        parser::timezone_t tz { parser::tz_info_t::LOCAL, 1, 0, 0 };
+        parser::context_t ctx {dt, mksec, tz, 1, 0, 0, parser::time_unit_t::NONE, nullptr };
+        const char* end = c.row(i) + c.lengths[i];
+        return G::parse(c.row(i), end, ctx) == end ? 1 + dt.mday : 0;
+    });
+    parse<G>(runner, "context/generic/value_context_t", c);
+    runner.run("context/generic/packed_context_t", c.size(), c.payload(), [&c](std::size_t i) -> std::size_t {
+        parser::packed_context_t ctx {};
+        ctx.year_sign = 1;
+        const char* end = c.row(i) + c.lengths[i];
+        return G::parse(c.row(i), end, ctx) == end ? 1 + ctx.dt.mday : 0;
+    });
+}
+
+// traced<G> against G; the counters add up over every round, so only their
+// ratios mean something
+void traces(runner_t& runner, const options_t& opt) {
+    using generic = parser::traced<parser::grammar_generic, parser::trace_on>;
+    using date = parser::traced<parser::grammar_date, parser::trace_on>;
+    const corpus_t generic_rows = corpus_t::make(opt, 6, generic_row);
+    const corpus_t date_rows = corpus_t::make(opt, 1, date_row);
+    parse<generic>(runner, "trace/generic/traced<grammar_generic>", generic_rows);
+    parse<date>(runner, "trace/date/traced<grammar_date>", date_rows);
+    if (runner.selected("trace/generic/traced<grammar_generic>")) parser::trace_of<generic>::report(std::cout);
+    if (runner.selected("trace/date/traced<grammar_date>")) parser::trace_of<date>::report(std::cout);
+    std::cout.flush();
+}
+
+// one layout through the grammars and the C/C++ library parsers
+void baselines(runner_t& runner, const options_t& opt) {
+    const corpus_t c = corpus_t::make(opt, 8, fixed_row);
+    parse<parser::grammar_generic>(runner, "baseline/parse/grammar_generic", c);
+    parse<parser::grammar_generic_fast>(runner, "baseline/parse/grammar_generic_fast", c);
+    parse<format_literal<generic_format>::grammar>(runner, "baseline/parse/format_literal<%F %T>::grammar", c);
+    pattern_t pattern;
+    pattern.compile("%Y-%m-%d %H:%M:%S");
+    runner.run("baseline/parse/pattern_t", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        parser::value_context_t ctx {};
+        const char* row = c.row(i);
+        const char* end = row + c.lengths[i];
+        return pattern.parse(row, end, ctx) == end ? 1 + ctx.dt.mday : 0;
+    });
+    runner.run("baseline/parse/strptime", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        std::tm tm {};
+        return strptime(c.row(i), "%Y-%m-%d %H:%M:%S", &tm) ? 1 + tm.tm_mday : 0;
+    });
+    runner.run("baseline/parse/sscanf", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        int y, mo, d, h, mi, s;
+        return std::sscanf(c.row(i), "%4d-%2d-%2d %2d:%2d:%2d", &y, &mo, &d, &h, &mi, &s) == 6 ? 1 + d : 0;
+    });
+    std::istringstream in;
+    runner.run("baseline/parse/std::get_time", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        std::tm tm {};
+        in.clear();
+        in.str(std::string(c.row(i), c.lengths[i]));
+        in >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+        return in.fail() ? 0 : 1 + tm.tm_mday;
+    });
+}
+
+// files of one layout: every row through the general grammars in turn, as
+// done without detection, against the shape detected on the first 64 rows
+void detection(runner_t& runner, const options_t& opt) {
+    using fallback = parser::detect_fallback<parser::value_context_t>;
+    const std::pair<const char*, corpus_t> corpora[] = {
+        {"iso_log", corpus_t::make(opt, 13, iso_log_row)},
+        {"fixed", corpus_t::make(opt, 8, fixed_row)},
+        {"http_date", corpus_t::make(opt, 10, http_date_row)},
+    };
+    for (const auto& named : corpora) {
+        const corpus_t& c = named.second;
+        const std::string prefix = std::string("detect/") + named.first + "/";
+        std::vector<parser::range_t> rows;
+        for (std::size_t i = 0; i < 64; ++i) rows.push_back(parser::range_t {c.row(i), c.row(i) + c.lengths[i]});
+        const parser::detected_t<> detected = parser::detector<>::sample(rows.data(), rows.size());
+        std::printf("%s: %s, %zu/%zu sampled rows\n", named.first, detected.name.c_str(), detected.matched, detected.sampled);
+        auto parse_with = [&c](std::size_t i, const auto& fn) -> std::size_t {
+            parser::value_context_t ctx = parser::value_context_t::local();
+            const char* end = c.row(i) + c.lengths[i];
+            return fn(c.row(i), end, ctx) == end ? 1 + ctx.dt.mday : 0;
+        };
+        runner.run(prefix + "grammars_in_turn", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+            return parse_with(i, &fallback::parse<parser::grammar_iso8601>);
+        });
+        runner.run(prefix + "detected_t", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+            return parse_with(i, [&detected](const char* ptr, const char* ptr_end, parser::value_context_t& ctx) {
+                return detected.parse(ptr, ptr_end, ctx);
+            });
+        });
+        runner.run(prefix + "detector::sample(64 rows)", 1, 0, [&](std::size_t) -> std::size_t {
+            return parser::detector<>::sample(rows.data(), rows.size()).matched;
+        });
+    }
+}
+
+// canonical rows parsed eagerly to epochs or into views, then filtered on the
+// year or on a range, or sorted; the sort of the views reads the rows at
+// random, so it is bound by the cache misses
+void views(runner_t& runner, const options_t& opt) {
+    using G = parser::grammar_iso8601;
+    const corpus_t c = corpus_t::make(opt, 14, canonical_row);
+    std::vector<parser::epoch_t> epochs(c.size());
+    std::vector<parser::view_t> views(c.size());
+    auto end = [&c](std::size_t i) { return c.row(i) + c.lengths[i]; };
+    runner.run("view/parse/epoch<grammar_iso8601>", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        return parser::epoch<G>::parse(c.row(i), end(i), epochs[i]) != NULL;
+    });
+    runner.run("view/parse/view<grammar_iso8601>", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        return parser::view<G>::parse(c.row(i), end(i), views[i]) != NULL;
+    });
+    for (std::size_t i = 0; i < c.size(); ++i) {
+        parser::epoch<G>::parse(c.row(i), end(i), epochs[i]);
+        parser::view<G>::parse(c.row(i), end(i), views[i]);
+    }
+    runner.run("view/year/grammar_iso8601", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        parser::value_context_t ctx = parser::value_context_t::local();
+        return 1 + (G::parse(c.row(i), end(i), ctx) && ctx.dt.year == 2020);
+    });
+    runner.run("view/year/view<grammar_iso8601>", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        parser::view_t v;
+        return 1 + (parser::view<G>::parse(c.row(i), end(i), v) && v.year() == 2020);
+    });
+    const char* lo_text = "2020-01-01T00:00:00.000000Z";
+    const char* hi_text = "2020-07-01T00:00:00.000000Z";
+    const std::size_t width = std::strlen(lo_text);
+    parser::epoch_t lo_epoch = 0, hi_epoch = 0;
+    parser::epoch<G>::parse(lo_text, lo_text + width, lo_epoch);
+    parser::epoch<G>::parse(hi_text, hi_text + width, hi_epoch);
+    parser::view_t lo, hi;
+    parser::view<G>::parse(lo_text, lo_text + width, lo);
+    parser::view<G>::parse(hi_text, hi_text + width, hi);
+    runner.run("view/range/epoch<grammar_iso8601>", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        parser::epoch_t value;
+        return 1 + (parser::epoch<G>::parse(c.row(i), end(i), value) && value >= lo_epoch && value < hi_epoch);
+    });
+    runner.run("view/range/view<grammar_iso8601>", c.size(), c.payload(), [&](std::size_t i) -> std::size_t {
+        parser::view_t v;
+        return 1 + (parser::view<G>::parse(c.row(i), end(i), v) && !(v < lo) && v < hi);
+    });
+    // one op sorts a copy of the whole column
+    std::vector<parser::epoch_t> sorted_epochs;
+    std::vector<parser::view_t> sorted_views;
+    runner.run("view/sort/epoch_t, whole column", 1, c.payload(), [&](std::size_t) -> std::size_t {
+        sorted_epochs = epochs;
+        std::sort(sorted_epochs.begin(), sorted_epochs.end());
+        return 1;
+    });
+    runner.run("view/sort/view_t as bytes, whole column", 1, c.payload(), [&](std::size_t) -> std::size_t {
+        sorted_views = views;
+        std::sort(sorted_views.begin(), sorted_views.end());
+        return 1;
+    });
+}
+
+// wall clock times of the zone, one every 7 hours over 20 years, in order
+// like the lines of a log or shuffled
+void zones(runner_t& runner, const options_t&) {
+    const char* name = "Europe/Berlin";
+    parser::zone_t zone;
+    if (!runner.selected("zone/")) return;
+    if (!zone.load_file(name)) {
+        std::printf("zone: %s not found, skipped\n", name);
+        return;
+    }
+    setenv("TZ", name, 1);
+    tzset();
+    std::vector<datetime> in_order;
+    for (int64_t t = 946684800; t < 946684800 + 20 * 365 * 86400LL; t += 3600 * 7 + 13) {
+        datetime dt;
+        parser::microsec_t mksec;
+        parser::civil::from_epoch(t * 1000000, dt, mksec);
+        in_order.push_back(dt);
+    }
+    std::vector<datetime> shuffled = in_order;
+    for (std::size_t i = shuffled.size() - 1; i > 0; --i) std::swap(shuffled[i], shuffled[(i * 2654435761u) % (i + 1)]);
+    auto to_utc = [&zone](const datetime& dt) {
+        const int64_t days = parser::civil::days_from_civil(dt.year, dt.mon, dt.mday);
+        return static_cast<std::size_t>(zone.to_utc(days * 86400 + (dt.hour * 60 + dt.min) * 60 + dt.sec));
+    };
+    runner.run("zone/to_utc/zone_t, in order", in_order.size(), 0, [&](std::size_t i) { return to_utc(in_order[i]); });
+    runner.run("zone/to_utc/zone_t, shuffled", shuffled.size(), 0, [&](std::size_t i) { return to_utc(shuffled[i]); });
+    runner.run("zone/to_utc/baseline/mktime, shuffled", shuffled.size(), 0, [&](std::size_t i) -> std::size_t {
+        const datetime& dt = shuffled[i];
+        std::tm tm {};
+        tm.tm_year = dt.year - 1900;
+        tm.tm_mon = dt.mon - 1;
+        tm.tm_mday = dt.mday;
+        tm.tm_hour = dt.hour;
+        tm.tm_min = dt.min;
+        tm.tm_sec = dt.sec;
+        tm.tm_isdst = -1;
+        return static_cast<std::size_t>(std::mktime(&tm));
+    });
+}
+
+// the generic rows in long runs of one shape, so that equal row counts are
+// not equal work; one op is the whole batch, 1 to hardware_concurrency threads
+void parallel(runner_t& runner, const options_t& opt) {
+    const corpus_t c = corpus_t::make(opt, 6, generic_row);
+    const std::size_t count = c.size();
+    std::vector<parser::range_t> rows(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t j = i / 1024 % count;
+        rows[i] = parser::range_t{c.row(j), c.row(j) + c.lengths[j]};
+    }
+    std::vector<int32_t> year(count), tz_offset(count);
+    std::vector<uint32_t> mon(count), mday(count), hour(count), min(count), sec(count);
+    std::vector<parser::microsec_t> mksec(count);
+    std::vector<uint64_t> ok(count / 64 + 1), utc(count / 64 + 1);
+    parser::columns_t out {
+        year.data(), mon.data(), mday.data(), hour.data(), min.data(), sec.data(),
+        mksec.data(), tz_offset.data(), ok.data(), utc.data()
+    };
+    const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= max_threads; ++threads) {
+        const std::string name = "parallel/generic/parallel_batch<grammar_generic>, " + std::to_string(threads) + " threads";
+        runner.run(name, 1, c.payload(), [&](std::size_t) -> std::size_t {
+            return parser::parallel_batch<parser::grammar_generic>::parse(rows.data(), count, out, threads);
+        });
+    }
+}
+
+// the sorted log through a column_t: parsed straight into it, decoded block
+// by block and rendered from it, against the plain epoch_t array
+void columns(runner_t& runner, const options_t& opt) {
+    using G = parser::grammar_generic;
+    const corpus_t log = corpus_t::make(opt, 9, log_rows());
+    parser::column_t column;
+    std::vector<parser::epoch_t> epochs(log.size());
+    for (std::size_t i = 0; i < log.size(); ++i) {
+        parser::column<G>::parse(log.row(i), log.row(i) + log.lengths[i], column);
+        parser::epoch<G>::parse(log.row(i), log.row(i) + log.lengths[i], epochs[i]);
+    }
+    const std::size_t fields = sizeof(datetime) + sizeof(parser::microsec_t) + sizeof(parser::timezone_t);
+    std::printf("column: %zu values in %zu bytes, %.2f bytes per value (datetime, mksec and timezone_t: %zu)\n",
+                column.size(), column.bytes(), static_cast<double>(column.bytes()) / column.size(), fields);
+
+    runner.run("column/parse/epoch<grammar_generic>", log.size(), log.payload(), [&](std::size_t i) -> std::size_t {
+        return parser::epoch<G>::parse(log.row(i), log.row(i) + log.lengths[i], epochs[i]) != NULL;
+    });
+    parser::column_t sink;
+    runner.run("column/parse/column<grammar_generic>", log.size(), log.payload(), [&](std::size_t i) -> std::size_t {
+        if (!i) sink.clear();
+        return parser::column<G>::parse(log.row(i), log.row(i) + log.lengths[i], sink) != NULL;
+    });
+    // one op is a block of 128 values
+    const std::size_t block = parser::column_t::block_size, blocks = column.blocks.size();
+    parser::epoch_t values[parser::column_t::block_size];
+    runner.run("column/decode/column_t::decode, per value", blocks * block, blocks * block * sizeof(parser::epoch_t), [&](std::size_t i) -> std::size_t {
+        if (i % block) return 1;
+        column.decode(i / block, values, nullptr);
+        return static_cast<std::size_t>(values[block - 1]) | 1;
+    });
+    runner.run("column/decode/baseline/epoch_t array, per value", blocks * block, blocks * block * sizeof(parser::epoch_t), [&](std::size_t i) -> std::size_t {
+        if (i % block) return 1;
+        std::memcpy(values, epochs.data() + i, sizeof(values));
+        return static_cast<std::size_t>(values[block - 1]) | 1;
+    });
+    const std::size_t n = iso_t::N;
+    std::vector<char> out(column.size() * (n + 1));
+    runner.run("column/render/batch_expression_t(column_t), whole column", 1, column.size() * n, [&](std::size_t) -> std::size_t {
+        return batch_expression_t<iso_t>::apply(column, out.data(), '\n');
+    });
+    runner.run("column/render/batch_expression_t(epoch_t*), whole column", 1, column.size() * n, [&](std::size_t) -> std::size_t {
+        return batch_expression_t<iso_t>::apply(epochs.data(), epochs.size(), out.data(), '\n');
+    });
+}
+
+// random values in the 4 digit years, rendered as "YYYY-MM-DD HH:MM:SS"
+void formatters(runner_t& runner, const options_t& opt) {
+    rng_t rng {opt.seed * 0x9E3779B97F4A7C15ull + 9};
+    std::vector<datetime> values(opt.rows);
+    for (auto& dt : values) {
+        dt = datetime{static_cast<int32_t>(rng.in(1970, 2038)), rng.in(1, 12), rng.in(1, 28), rng.below(24), rng.below(60), rng.below(60)};
+    }
+    // a log stream: sorted, a few values per second
+    std::vector<datetime> stream(opt.rows);
+    for (std::size_t i = 0; i < opt.rows; ++i) {
+        parser::microsec_t mksec;
+        parser::civil::from_epoch((1500000000 + static_cast<int64_t>(i) / 4) * 1000000, stream[i], mksec);
+    }
+    const std::size_t n = iso_t::N;
+    const std::size_t bytes = opt.rows * n;
+    std::vector<char> out(opt.rows * (n + 1) + 64);
+    char* buff = out.data();
+
+    runner.run("format/expression_t", opt.rows, bytes, [&](std::size_t i) -> std::size_t {
+        datetime dt = values[i];
+        return *(iso_t::apply(buff + i * (n + 1), dt) - 1);
+    });
+    cached_expression_t<iso_t> cached;
+    runner.run("format/cached_expression_t, random", opt.rows, bytes, [&](std::size_t i) -> std::size_t {
+        datetime dt = values[i];
+        return *(cached.apply(buff + i * (n + 1), dt) - 1);
+    });
+    runner.run("format/cached_expression_t, stream", opt.rows, bytes, [&](std::size_t i) -> std::size_t {
+        datetime dt = stream[i];
+        return *(cached.apply(buff + i * (n + 1), dt) - 1);
+    });
+    // one op is a block of 256 rows
+    const std::size_t block = 256, blocks = opt.rows / block;
+    runner.run("format/batch_expression_t, per row", blocks * block, blocks * block * n, [&](std::size_t i) -> std::size_t {
+        if (i % block) return 1;
+        return batch_expression_t<iso_t>::apply(values.data() + i, block, buff + i * (n + 1), '\n');
+    });
+    runner.run("format/batch_rows, per row", blocks * block, blocks * block * n, [&](std::size_t i) -> std::size_t {
+        if (i % block) return 1;
+        return batch_rows<iso_t>::apply(values.data() + i, block, buff + i * (n + 1), '\n');
+    });
+    pattern_t pattern;
+    pattern.compile("%Y-%m-%d %H:%M:%S");
+    runner.run("format/pattern_t", opt.rows, bytes, [&](std::size_t i) -> std::size_t {
+        return *(pattern.format(buff + i * (n + 1), values[i]) - 1);
+    });
+    runner.run("format/baseline/strftime", opt.rows, bytes, [&](std::size_t i) -> std::size_t {
+        const datetime& dt = values[i];
+        std::tm tm {};
+        tm.tm_year = dt.year - 1900;
+        tm.tm_mon = dt.mon - 1;
+        tm.tm_mday = dt.mday;
+        tm.tm_hour = dt.hour;
+        tm.tm_min = dt.min;
+        tm.tm_sec = dt.sec;
+        return std::strftime(buff + i * (n + 1), n + 1, "%Y-%m-%d %H:%M:%S", &tm);
+    });
+    const std::size_t http_n = http_date_t::N;
+    runner.run("format/http_date_t", opt.rows, opt.rows * http_n, [&](std::size_t i) -> std::size_t {
+        datetime dt = values[i];
+        return *(http_date_t::apply(buff + i * (n + 1) % (out.size() - 64), dt) - 1);
+    });
+    runner.run("format/baseline/strftime, http date", opt.rows, opt.rows * http_n, [&](std::size_t i) -> std::size_t {
+        const datetime& dt = values[i];
+        std::tm tm {};
+        tm.tm_year = dt.year - 1900;
+        tm.tm_mon = dt.mon - 1;
+        tm.tm_mday = dt.mday;
+        tm.tm_wday = static_cast<int>(parser::civil::week_day(parser::civil::days_from_civil(dt.year, dt.mon, dt.mday)) % 7);
+        tm.tm_hour = dt.hour;
+        tm.tm_min = dt.min;
+        tm.tm_sec = dt.sec;
+        return std::strftime(buff + i * (n + 1) % (out.size() - 64), http_n + 1, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    });
+    runner.run("format/baseline/snprintf", opt.rows, bytes, [&](std::size_t i) -> std::size_t {
+        const datetime& dt = values[i];
+        return std::snprintf(buff + i * (n + 1), n + 1, "%04d-%02u-%02u %02u:%02u:%02u", dt.year, dt.mon, dt.mday, dt.hour, dt.min, dt.sec);
+    });
+}
+
+int usage(const char* name) {
+    std::fprintf(stderr, "usage: %s [--rows=N] [--trials=N] [--seed=N] [filter...]\n", name);
+    return 2;
+}
+
+}
+
+int main(int argc, char** argv) {
+    options_t opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (!std::strncmp(arg, "--rows=", 7)) {
+            opt.rows = std::strtoull(arg + 7, nullptr, 10);
+            if (opt.rows < 256) return usage(argv[0]);
+        } else if (!std::strncmp(arg, "--trials=", 9)) {
+            opt.trials = std::atoi(arg + 9);
+            if (opt.trials <= 0) return usage(argv[0]);
+        } else if (!std::strncmp(arg, "--seed=", 7)) {
+            opt.seed = std::strtoull(arg + 7, nullptr, 10) | 1;
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            return usage(argv[0]);
+        } else {
+            opt.filters.push_back(arg);
+        }
+    }
+    runner_t runner(opt);
+    parsers(runner, opt);
+    contexts(runner, opt);
+    traces(runner, opt);
+    baselines(runner, opt);
+    detection(runner, opt);
+    views(runner, opt);
+    zones(runner, opt);
+    parallel(runner, opt);
+    columns(runner, opt);
+    formatters(runner, opt);
+    return 0;
+}
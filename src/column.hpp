@@ -0,0 +1,276 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "cpu.hpp"
+#include "iso8601.hpp"
+#include "epoch.hpp"
+
+namespace parser {
+
+// Parsed timestamps as a compact column of epoch microseconds and zone offsets
+// in minutes. Every 128 values make a block: the first value, then the deltas
+// or the deltas of the deltas, whichever is narrower, zigzag encoded and bit
+// packed at the width of the widest one. The offsets are packed the same way
+// around the block's first one, usually at width 0. The values of the last,
+// incomplete block are kept as they are until it fills up.
+//
+// A block is packed as 4 interleaved bit streams, value i in stream i % 4, and
+// word k of stream s stored at 4 * k + s, so that one 256-bit load holds the
+// same bits of 4 consecutive values and the decoder unpacks, zigzag decodes
+// and sums 4 values per step. Blocks are decoded independently.
+
+struct column_block_t {
+    uint64_t start;                                 // running sum before the first value
+    uint64_t step;                                  // running delta before the first value, order 2 only
+    uint32_t offset;                                // of the packed values in column_t::words
+    uint8_t bits;
+    uint8_t order;                                  // 1: deltas, 2: deltas of deltas
+    uint8_t tz_bits;
+    int16_t tz_base;
+};
+
+// the bit packing of one block of column_t::block_size values
+struct column_kernel {
+    static const std::size_t size = 128;
+    static const std::size_t streams = 4;
+
+    static inline std::size_t words(unsigned bits) { return streams * ((bits + 1) / 2); }
+
+    static inline uint64_t zigzag(uint64_t value) { return value << 1 ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63); }
+    static inline uint64_t unzigzag(uint64_t value) { return value >> 1 ^ (0 - (value & 1)); }
+
+    static inline unsigned width(uint64_t any) { return any ? 64 - __builtin_clzll(any) : 0; }
+
+    // in[i] at bits [j * bits, (j + 1) * bits) of stream i % 4, j = i / 4; out
+    // is words(bits) zeroed words
+    static inline void pack(const uint64_t* in, unsigned bits, uint64_t* out) {
+        if (!bits) return;
+        for (std::size_t i = 0; i < size; ++i) {
+            const std::size_t at = (i / streams) * bits, k = at / 64, shift = at % 64, s = i % streams;
+            out[streams * k + s] |= in[i] << shift;
+            if (shift + bits > 64) out[streams * (k + 1) + s] |= in[i] >> (64 - shift);
+        }
+    }
+
+    static inline uint64_t unpack(const uint64_t* in, unsigned bits, std::size_t i) {
+        const std::size_t at = (i / streams) * bits, k = at / 64, shift = at % 64, s = i % streams;
+        uint64_t value = in[streams * k + s] >> shift;
+        if (shift + bits > 64) value |= in[streams * (k + 1) + s] << (64 - shift);
+        return bits == 64 ? value : value & ((uint64_t(1) << bits) - 1);
+    }
+
+    // order 0: start + v[i], order 1: start + the sum of v[0..i], order 2: the
+    // same over step + the sum of v[0..i]; wrapping, as encoded
+    static inline void scalar(const uint64_t* in, unsigned bits, unsigned order, uint64_t start, uint64_t step, uint64_t* out) {
+        uint64_t sum = start;
+        for (std::size_t i = 0; i < size; ++i) {
+            const uint64_t v = bits ? unzigzag(unpack(in, bits, i)) : 0;
+            if (order == 0) {
+                out[i] = start + v;
+            } else if (order == 1) {
+                out[i] = sum += v;
+            } else {
+                step += v;
+                out[i] = sum += step;
+            }
+        }
+    }
+
+#if LAZY_X86
+    // sums of the 4 lanes from the first, plus carry
+    LAZY_TARGET_AVX2 static inline __m256i prefix(__m256i x, __m256i carry) {
+        const __m256i zero = _mm256_setzero_si256();
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F));
+        return _mm256_add_epi64(x, carry);
+    }
+
+    LAZY_TARGET_AVX2 static inline void avx2(const uint64_t* in, unsigned bits, unsigned order, uint64_t start, uint64_t step, uint64_t* out) {
+        const __m256i mask = _mm256_set1_epi64x(bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1);
+        const __m256i one = _mm256_set1_epi64x(1);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i sum = _mm256_set1_epi64x(static_cast<int64_t>(start));
+        __m256i delta = _mm256_set1_epi64x(static_cast<int64_t>(step));
+        for (std::size_t j = 0; j < size / streams; ++j) {
+            __m256i v = zero;
+            if (bits) {
+                const std::size_t at = j * bits, k = at / 64, shift = at % 64;
+                v = _mm256_srl_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + streams * k)), _mm_cvtsi64_si128(shift));
+                if (shift + bits > 64) {
+                    const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + streams * (k + 1)));
+                    v = _mm256_or_si256(v, _mm256_sll_epi64(next, _mm_cvtsi64_si128(64 - shift)));
+                }
+                v = _mm256_and_si256(v, mask);
+                v = _mm256_xor_si256(_mm256_srli_epi64(v, 1), _mm256_sub_epi64(zero, _mm256_and_si256(v, one)));
+            }
+            __m256i values;
+            if (order == 0) {
+                values = _mm256_add_epi64(sum, v);
+            } else if (order == 1) {
+                values = sum = prefix(v, sum);
+            } else {
+                delta = prefix(v, delta);
+                values = prefix(delta, sum);
+                delta = _mm256_permute4x64_epi64(delta, _MM_SHUFFLE(3, 3, 3, 3));
+            }
+            if (order) sum = _mm256_permute4x64_epi64(values, _MM_SHUFFLE(3, 3, 3, 3));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + streams * j), values);
+        }
+    }
+#endif
+
+    using fn_t = void (*)(const uint64_t*, unsigned, unsigned, uint64_t, uint64_t, uint64_t*);
+
+    static inline fn_t select() {
+#if LAZY_X86
+        if (cpu::level() == cpu::level_t::AVX2) return &avx2;
+#endif
+        return &scalar;
+    }
+
+    static inline void decode(const uint64_t* in, unsigned bits, unsigned order, uint64_t start, uint64_t step, uint64_t* out) {
+        static const fn_t fn = select();
+        fn(in, bits, order, start, step, out);
+    }
+};
+
+struct column_t {
+    static const std::size_t block_size = column_kernel::size;
+    static const int16_t local = INT16_MIN;         // offset of a LOCAL time
+
+    std::vector<column_block_t> blocks;
+    std::vector<uint64_t> words;
+    epoch_t tail[block_size];
+    int16_t tail_offsets[block_size];
+    std::size_t tail_count = 0;
+
+    template <typename Context>
+    static inline int16_t offset_of(const Context& ctx) {
+        if (ctx.tz.tz_info == tz_info_t::LOCAL) return local;
+        return static_cast<int16_t>(ctx.tz.sign * static_cast<int32_t>(ctx.tz.hour * 60 + ctx.tz.minute));
+    }
+
+    std::size_t size() const { return blocks.size() * block_size + tail_count; }
+
+    // the incomplete block counts as one
+    std::size_t block_count() const { return blocks.size() + (tail_count != 0); }
+
+    // encoded bytes, the tail included
+    std::size_t bytes() const {
+        return blocks.size() * sizeof(column_block_t) + words.size() * sizeof(uint64_t) + tail_count * (sizeof(epoch_t) + sizeof(int16_t));
+    }
+
+    void clear() {
+        blocks.clear();
+        words.clear();
+        tail_count = 0;
+    }
+
+    inline void append(epoch_t value, int16_t offset) {
+        tail[tail_count] = value;
+        tail_offsets[tail_count] = offset;
+        if (++tail_count == block_size) seal();
+    }
+
+    // values [b * block_size, ...) to values and offsets (either may be NULL),
+    // returns how many
+    inline std::size_t decode(std::size_t b, epoch_t* values, int16_t* offsets) const {
+        if (b == blocks.size()) {
+            if (values) std::memcpy(values, tail, tail_count * sizeof(epoch_t));
+            if (offsets) std::memcpy(offsets, tail_offsets, tail_count * sizeof(int16_t));
+            return tail_count;
+        }
+        const column_block_t& block = blocks[b];
+        const uint64_t* in = words.data() + block.offset;
+        if (values) {
+            static_assert(sizeof(epoch_t) == sizeof(uint64_t), "epochs are decoded as 64-bit words");
+            column_kernel::decode(in, block.bits, block.order, block.start, block.step, reinterpret_cast<uint64_t*>(values));
+        }
+        if (offsets) {
+            if (!block.tz_bits) {
+                for (std::size_t i = 0; i < block_size; ++i) offsets[i] = block.tz_base;
+            } else {
+                uint64_t decoded[block_size];
+                column_kernel::decode(in + column_kernel::words(block.bits), block.tz_bits, 0,
+                                      static_cast<uint64_t>(static_cast<int64_t>(block.tz_base)), 0, decoded);
+                for (std::size_t i = 0; i < block_size; ++i) offsets[i] = static_cast<int16_t>(decoded[i]);
+            }
+        }
+        return block_size;
+    }
+
+    // one value, through its block
+    inline epoch_t at(std::size_t i, int16_t* offset = nullptr) const {
+        epoch_t values[block_size];
+        int16_t offsets[block_size];
+        decode(i / block_size, values, offset ? offsets : nullptr);
+        if (offset) *offset = offsets[i % block_size];
+        return values[i % block_size];
+    }
+
+private:
+    inline void seal() {
+        uint64_t v[block_size], d1[block_size], d2[block_size], tz[block_size];
+        std::memcpy(v, tail, sizeof(v));
+        // the delta before the first value is taken equal to the second one
+        const uint64_t step = v[1] - v[0];
+        uint64_t any1 = 0, any2 = 0, any_tz = 0, previous = step;
+        for (std::size_t i = 0; i < block_size; ++i) {
+            const uint64_t delta = i ? v[i] - v[i - 1] : step;
+            any1 |= d1[i] = column_kernel::zigzag(i ? delta : 0);
+            any2 |= d2[i] = column_kernel::zigzag(delta - previous);
+            any_tz |= tz[i] = column_kernel::zigzag(static_cast<uint64_t>(static_cast<int64_t>(tail_offsets[i]) - tail_offsets[0]));
+            previous = delta;
+        }
+        column_block_t block;
+        block.offset = static_cast<uint32_t>(words.size());
+        block.tz_base = tail_offsets[0];
+        block.tz_bits = static_cast<uint8_t>(column_kernel::width(any_tz));
+        const unsigned bits1 = column_kernel::width(any1), bits2 = column_kernel::width(any2);
+        block.order = bits2 < bits1 ? 2 : 1;
+        block.bits = static_cast<uint8_t>(block.order == 2 ? bits2 : bits1);
+        block.start = block.order == 2 ? v[0] - step : v[0];
+        block.step = block.order == 2 ? step : 0;
+        words.resize(words.size() + column_kernel::words(block.bits) + column_kernel::words(block.tz_bits), 0);
+        column_kernel::pack(block.order == 2 ? d2 : d1, block.bits, words.data() + block.offset);
+        column_kernel::pack(tz, block.tz_bits, words.data() + block.offset + column_kernel::words(block.bits));
+        blocks.push_back(block);
+        tail_count = 0;
+    }
+};
+
+// parses straight into a column: epoch microseconds, a LOCAL time taken as UTC,
+// and the offset it was written with
+template <typename G>
+struct column {
+    // one row, appended on success only; the end of the match or NULL, also
+    // for a year out of civil::in_range()
+    static inline const char* parse(const char* ptr, const char* ptr_end, column_t& out) {
+        value_context_t ctx = value_context_t::local();
+        const char* result = G::parse(ptr, ptr_end, ctx);
+        if (!result || !civil::in_range(ctx)) return NULL;
+        out.append(civil::to_epoch(ctx), column_t::offset_of(ctx));
+        return result;
+    }
+
+    // a delim-separated buffer, a trailing delimiter does not start an empty
+    // row; the rows not parsed whole are left out. Returns the rows appended.
+    static inline std::size_t parse(const char* ptr, const char* ptr_end, char delim, column_t& out) {
+        std::size_t count = 0;
+        while (ptr < ptr_end) {
+            const char* row_end = static_cast<const char*>(std::memchr(ptr, delim, ptr_end - ptr));
+            if (!row_end) row_end = ptr_end;
+            value_context_t ctx = value_context_t::local();
+            if (G::parse(ptr, row_end, ctx) == row_end && civil::in_range(ctx)) {
+                out.append(civil::to_epoch(ctx), column_t::offset_of(ctx));
+                ++count;
+            }
+            ptr = row_end + 1;
+        }
+        return count;
+    }
+};
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LAZY_X86 1
+#include <immintrin.h>
+#define LAZY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LAZY_X86 0
+#endif
+
+namespace cpu {
+
+enum class level_t { SCALAR = 0, SSE2, AVX2 };
+
+// detected once; every dispatcher caches its own choice on top of this
+inline level_t level() {
+#if LAZY_X86
+    static const level_t value = __builtin_cpu_supports("avx2") ? level_t::AVX2
+                               : __builtin_cpu_supports("sse2") ? level_t::SSE2
+                               : level_t::SCALAR;
+    return value;
+#else
+    return level_t::SCALAR;
+#endif
+}
+
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "iso8601.hpp"
+#include "batch.hpp"
+#include "keyword.hpp"
+#include "literal.hpp"
+
+// Format auto-detection for inputs of unknown layout: detector<Context> runs
+// the first rows through a list of shapes, the fixed branches of the general
+// grammars (compact or extended, with or without fraction and zone), and
+// returns a detected_t bound to the shape which took the most rows whole:
+//
+//   auto parser = parser::detector<>::sample(buffer, buffer_end, '\n', 64);
+//   parser.parse(row, row_end, ctx);               // the row end or NULL
+//
+// A shape is one op_seq without alternatives; a row it does not take goes to
+// the general grammars, the family of the shape first, each from the context
+// the row started with. The contexts are copied, so they are held by value
+// (value_context_t, packed_context_t).
+
+namespace parser {
+
+// parts of a shape: terms of the family grammar and the bytes they take
+template <typename ...Terms> struct shape_part {
+    using terms = type_list<Terms...>;
+};
+
+struct part_none: shape_part<> { static constexpr const char* name = ""; };
+
+struct part_iso_date_extended: shape_part<term_year, term_char<'-'>, term_month, term_char<'-'>, term_day> {
+    static constexpr const char* name = "YYYY-MM-DD";
+};
+struct part_iso_date_basic: shape_part<term_year, term_month, term_day> {
+    static constexpr const char* name = "YYYYMMDD";
+};
+struct part_iso_time_extended: shape_part<term_char<'T'>, term_hour, term_char<':'>, term_min, term_char<':'>, term_sec> {
+    static constexpr const char* name = "Thh:mm:ss";
+};
+struct part_iso_time_basic: shape_part<term_char<'T'>, term_hour, term_min, term_sec> {
+    static constexpr const char* name = "Thhmmss";
+};
+struct part_generic_date: shape_part<term_year_v, op_or<term_char<'-'>, term_char<'/'>>, term_month, op_or<term_char<'-'>, term_char<'/'>>, term_day> {
+    static constexpr const char* name = "Y-MM-DD";
+};
+struct part_generic_time: shape_part<term_char<' '>, term_hour_v, term_char<':'>, term_min_v, term_char<':'>, term_sec_v> {
+    static constexpr const char* name = " h:m:s";
+};
+struct part_fraction: shape_part<term_fraction> { static constexpr const char* name = ".f"; };
+struct part_utc: shape_part<term_tz_UTC> { static constexpr const char* name = "Z"; };
+struct part_offset: shape_part<op_or<term_tz_sing<'+'>, term_tz_sing<'-'>>, grammar_tz_offset> {
+    static constexpr const char* name = "+hh[[:]mm]";
+};
+template <typename G> struct part_whole: shape_part<G> { static constexpr const char* name = ""; };
+
+template <typename G> struct family_name;
+template <> struct family_name<grammar_iso8601> { static constexpr const char* value = "iso8601"; };
+template <> struct family_name<grammar_generic> { static constexpr const char* value = "generic"; };
+template <> struct family_name<grammar_rfc2822> { static constexpr const char* value = "rfc2822"; };
+template <> struct family_name<grammar_http_date> { static constexpr const char* value = "http_date"; };
+template <> struct family_name<grammar_syslog> { static constexpr const char* value = "syslog"; };
+
+template <typename Family, typename ...Parts>
+struct shape {
+    using family = Family;
+    using grammar = typename apply_list<op_seq, typename join<typename Parts::terms...>::type>::type;
+
+    static std::string name() {
+        std::string layout;
+        (void)std::initializer_list<int>{(layout += Parts::name, 0)...};
+        return layout.empty() ? family_name<Family>::value : family_name<Family>::value + (" " + layout);
+    }
+};
+
+template <typename Date, typename Time, typename Fraction, typename Tz>
+using iso_shape = shape<grammar_iso8601, Date, Time, Fraction, Tz>;
+template <typename Fraction, typename Tz>
+using generic_shape = shape<grammar_generic, part_generic_date, part_generic_time, Fraction, Tz>;
+
+// ties go to the first one; the basic time takes no fraction in grammar_iso8601
+using detect_shapes = type_list<
+    iso_shape<part_iso_date_extended, part_iso_time_extended, part_none, part_none>,
+    iso_shape<part_iso_date_extended, part_iso_time_extended, part_none, part_utc>,
+    iso_shape<part_iso_date_extended, part_iso_time_extended, part_none, part_offset>,
+    iso_shape<part_iso_date_extended, part_iso_time_extended, part_fraction, part_none>,
+    iso_shape<part_iso_date_extended, part_iso_time_extended, part_fraction, part_utc>,
+    iso_shape<part_iso_date_extended, part_iso_time_extended, part_fraction, part_offset>,
+    iso_shape<part_iso_date_basic, part_iso_time_basic, part_none, part_none>,
+    iso_shape<part_iso_date_basic, part_iso_time_basic, part_none, part_utc>,
+    iso_shape<part_iso_date_basic, part_iso_time_basic, part_none, part_offset>,
+    iso_shape<part_iso_date_extended, part_none, part_none, part_none>,
+    iso_shape<part_iso_date_basic, part_none, part_none, part_none>,
+    generic_shape<part_none, part_none>,
+    generic_shape<part_none, part_offset>,
+    generic_shape<part_fraction, part_none>,
+    generic_shape<part_fraction, part_offset>,
+    shape<grammar_http_date, part_whole<grammar_http_date>>,
+    shape<grammar_rfc2822, part_whole<grammar_rfc2822>>,
+    shape<grammar_syslog, part_whole<grammar_syslog>>
+>;
+
+// what the rows were parsed with before detection, one grammar after the other
+using detect_families = type_list<grammar_iso8601, grammar_generic, grammar_rfc2822, grammar_syslog>;
+
+template <typename Context, typename Families = detect_families> struct detect_fallback;
+template <typename Context, typename ...Gs>
+struct detect_fallback<Context, type_list<Gs...>> {
+    template <typename G>
+    static inline bool whole(const char* ptr, const char* ptr_end, const Context& initial, Context& ctx) {
+        ctx = initial;
+        return G::parse(ptr, ptr_end, ctx) == ptr_end;
+    }
+
+    // Family, then the others in order; the row end or NULL
+    template <typename Family>
+    static const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        const Context initial = ctx;
+        bool ok = whole<Family>(ptr, ptr_end, initial, ctx);
+        (void)std::initializer_list<int>{(ok = ok || (!std::is_same<Gs, Family>::value && whole<Gs>(ptr, ptr_end, initial, ctx)), 0)...};
+        return ok ? ptr_end : NULL;
+    }
+};
+
+template <typename Context = value_context_t>
+struct detected_t {
+    using fn_t = const char* (*)(const char*, const char*, Context&);
+
+    std::string name;                               // shape, empty when no sampled row was taken whole
+    fn_t exact;
+    fn_t fallback;
+    std::size_t matched;                            // sampled rows taken whole by the shape
+    std::size_t sampled;
+
+    // the exact grammar when no shape took a sampled row: every row goes
+    // straight to the fallback
+    static const char* no_shape(const char*, const char*, Context&) { return NULL; }
+
+    inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) const {
+        const Context initial = ctx;
+        if (exact(ptr, ptr_end, ctx) == ptr_end) return ptr_end;
+        ctx = initial;
+        return fallback(ptr, ptr_end, ctx);
+    }
+};
+
+template <typename Context = value_context_t, typename Shapes = detect_shapes> struct detector;
+template <typename Context, typename ...Shapes>
+struct detector<Context, type_list<Shapes...>> {
+    static const std::size_t count = sizeof...(Shapes);
+
+    static detected_t<Context> sample(const range_t* rows, std::size_t rows_count) {
+        std::size_t hits[count] = {};
+        for (std::size_t i = 0; i < rows_count; ++i) {
+            std::size_t s = 0;
+            (void)std::initializer_list<int>{(hits[s++] += whole<typename Shapes::grammar>(rows[i]), 0)...};
+        }
+        std::size_t best = 0;
+        for (std::size_t s = 1; s < count; ++s) {
+            if (hits[s] > hits[best]) best = s;
+        }
+        detected_t<Context> result {std::string(), &detected_t<Context>::no_shape,
+                                    &detect_fallback<Context>::template parse<grammar_iso8601>, 0, rows_count};
+        if (!hits[best]) return result;
+        std::size_t s = 0;
+        (void)std::initializer_list<int>{(bind<Shapes>(s++ == best, result), 0)...};
+        result.matched = hits[best];
+        return result;
+    }
+
+    // the first rows of a delim-separated buffer, a trailing delimiter does
+    // not start an empty row
+    static detected_t<Context> sample(const char* ptr, const char* ptr_end, char delim, std::size_t max_rows) {
+        std::vector<range_t> rows;
+        while (ptr < ptr_end && rows.size() < max_rows) {
+            const char* row_end = static_cast<const char*>(std::memchr(ptr, delim, ptr_end - ptr));
+            if (!row_end) row_end = ptr_end;
+            rows.push_back(range_t {ptr, row_end});
+            ptr = row_end + 1;
+        }
+        return sample(rows.data(), rows.size());
+    }
+
+private:
+    template <typename G>
+    static inline std::size_t whole(const range_t& row) {
+        Context ctx {};
+        ctx.year_sign = 1;
+        return G::parse(row.begin, row.end, ctx) == row.end;
+    }
+
+    template <typename Shape>
+    static inline void bind(bool chosen, detected_t<Context>& result) {
+        if (!chosen) return;
+        result.name = Shape::name();
+        result.exact = &Shape::grammar::template parse<Context>;
+        result.fallback = &detect_fallback<Context>::template parse<typename Shape::family>;
+    }
+};
+
+}
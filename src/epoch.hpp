@@ -0,0 +1,122 @@
+#pragma once
+
+#include "iso8601.hpp"
+
+namespace parser {
+
+using epoch_t = int64_t;                            // microseconds since 1970-01-01T00:00:00Z
+
+// proleptic Gregorian calendar, days since 1970-01-01; no tables and no libc,
+// the conditionals compile to selects
+struct civil {
+    static inline int64_t days_from_civil(int64_t y, uint32_t m, uint32_t d) {
+        y -= m <= 2;
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const uint32_t yoe = static_cast<uint32_t>(y - era * 400);                       // [0, 399]
+        const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;            // [0, 365]
+        const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                      // [0, 146096]
+        return era * 146097 + static_cast<int64_t>(doe) - 719468;
+    }
+
+    // ISO weekday of a day number, Monday = 1 .. Sunday = 7
+    static inline uint32_t week_day(int64_t days) {
+        const int64_t r = (days + 3) % 7;
+        return static_cast<uint32_t>(r < 0 ? r + 7 : r) + 1;
+    }
+
+    // ISO week date, week 1 is the one with January 4th
+    static inline int64_t days_from_week(int64_t y, uint32_t week, uint32_t week_day) {
+        const int64_t jan4 = days_from_civil(y, 1, 4);
+        return jan4 - (civil::week_day(jan4) - 1) + (week - 1) * 7 + (week_day - 1);
+    }
+
+    static inline int64_t days_from_ordinal(int64_t y, uint32_t day) {
+        return days_from_civil(y, 1, 1) + day - 1;
+    }
+
+    // inverse of days_from_civil
+    static inline void civil_from_days(int64_t days, int32_t& y, uint32_t& m, uint32_t& d) {
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const uint32_t doe = static_cast<uint32_t>(days - era * 146097);                 // [0, 146096]
+        const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;      // [0, 399]
+        const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);                    // [0, 365]
+        const uint32_t mp = (5 * doy + 2) / 153;                                         // [0, 11], from March
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = static_cast<int32_t>(static_cast<int64_t>(yoe) + era * 400 + (m <= 2));
+    }
+
+    // floor division, so that the times before 1970 come out right
+    static inline void from_epoch(epoch_t value, datetime& dt, microsec_t& mksec) {
+        int64_t seconds = value / 1000000, us = value % 1000000;
+        if (us < 0) {
+            us += 1000000;
+            --seconds;
+        }
+        int64_t days = seconds / 86400, rest = seconds % 86400;
+        if (rest < 0) {
+            rest += 86400;
+            --days;
+        }
+        civil_from_days(days, dt.year, dt.mon, dt.mday);
+        dt.hour = static_cast<uint32_t>(rest / 3600);
+        dt.min = static_cast<uint32_t>(rest / 60 % 60);
+        dt.sec = static_cast<uint32_t>(rest % 60);
+        mksec = static_cast<microsec_t>(us);
+    }
+
+    // epoch_t microseconds cover about 292,000 years either side of 1970, the
+    // grammars take years of up to 10 digits
+    static const int32_t max_year = 290000;
+
+    template <typename Context>
+    static inline bool in_range(const Context& ctx) {
+        return ctx.dt.year >= -max_year && ctx.dt.year <= max_year;
+    }
+
+    // what the grammars leave in the context: week date when week is set,
+    // ordinal date when mon is 0 and mday is not, missing fields are the first
+    // ones; a LOCAL time is taken as UTC. The year must be in_range().
+    template <typename Context>
+    static inline epoch_t to_epoch(const Context& ctx) {
+        const auto& dt = ctx.dt;
+        int64_t days;
+        if (ctx.week) {
+            days = days_from_week(dt.year, ctx.week, ctx.week_day ? ctx.week_day : 1);
+        } else if (!dt.mon && dt.mday) {
+            days = days_from_ordinal(dt.year, dt.mday);
+        } else {
+            days = days_from_civil(dt.year, dt.mon + !dt.mon, dt.mday + !dt.mday);
+        }
+        const int64_t offset = ctx.tz.sign * static_cast<int64_t>(ctx.tz.hour * 60 + ctx.tz.minute) * 60;
+        const int64_t seconds = days * 86400 + (dt.hour * 60 + dt.min) * 60 + dt.sec - offset;
+        return seconds * 1000000 + ctx.mksec;
+    }
+};
+
+// bytes to epoch microseconds in one call, returns the end of the parsed input
+// or NULL like the grammars, and NULL for a year out of civil::in_range();
+// value is written on success only
+template <typename G>
+struct epoch {
+    static inline const char* parse(const char* ptr, const char* ptr_end, epoch_t& value) {
+        value_context_t ctx = value_context_t::local();
+        const char* result = G::parse(ptr, ptr_end, ctx);
+        if (!result || !civil::in_range(ctx)) return NULL;
+        value = civil::to_epoch(ctx);
+        return result;
+    }
+
+    // LOCAL times taken in a zone_t (see zone.hpp) rather than as UTC
+    template <typename Zone>
+    static inline const char* parse(const char* ptr, const char* ptr_end, epoch_t& value, const Zone& zone) {
+        value_context_t ctx = value_context_t::local();
+        const char* result = G::parse(ptr, ptr_end, ctx);
+        if (!result || !civil::in_range(ctx)) return NULL;
+        value = zone.to_epoch(ctx);
+        return result;
+    }
+};
+
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <type_traits>
+#include "iso8601.hpp"
+#include "validate.hpp"
+
+namespace parser {
+
+// fields of the fixed "YYYY-MM-DD HH:MM:SS[.ffffff]" layout, '/' is accepted as date separator
+struct fixed_datetime_t {
+    uint32_t year;
+    uint32_t mon;
+    uint32_t mday;
+    uint32_t hour;
+    uint32_t min;
+    uint32_t sec;
+    uint32_t fraction;
+    bool has_fraction;                              // exactly 6 fraction digits at [20, 26)
+};
+
+// kernels check the 19 bytes prefix (caller guarantees they are readable) and,
+// when there are 26 bytes, the fraction; they never touch the context
+struct kernel_datetime {
+    static const int size = 19;
+    static const int size_fraction = 26;
+
+    static inline unsigned digit(const char* ptr) {
+        return static_cast<unsigned>(static_cast<unsigned char>(*ptr)) - '0';
+    }
+
+    // a 7th digit would be eaten by term_fraction_p, so leave such input to the grammar
+    static inline bool fraction_bounds(const char* ptr, const char* ptr_end) {
+        if (ptr_end - ptr < size_fraction || (ptr[19] != '.' && ptr[19] != ',')) return false;
+        return ptr_end - ptr == size_fraction || digit(ptr + size_fraction) > 9;
+    }
+
+    static inline bool scalar(const char* ptr, const char* ptr_end, fixed_datetime_t& f) {
+        if ((ptr[4] != '-' && ptr[4] != '/') || (ptr[7] != '-' && ptr[7] != '/')
+            || ptr[10] != ' ' || ptr[13] != ':' || ptr[16] != ':') return false;
+        static const unsigned char positions[] = {0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18};
+        unsigned d[sizeof(positions)];
+        unsigned bad = 0;
+        for (unsigned i = 0; i < sizeof(positions); ++i) {
+            d[i] = digit(ptr + positions[i]);
+            bad |= d[i] > 9;
+        }
+        if (bad) return false;
+        f.year = ((d[0] * 10 + d[1]) * 10 + d[2]) * 10 + d[3];
+        f.mon  = d[4] * 10 + d[5];
+        f.mday = d[6] * 10 + d[7];
+        f.hour = d[8] * 10 + d[9];
+        f.min  = d[10] * 10 + d[11];
+        f.sec  = d[12] * 10 + d[13];
+        f.has_fraction = false;
+        if (fraction_bounds(ptr, ptr_end)) {
+            uint32_t value = 0;
+            for (const char* it = ptr + 20; it != ptr + size_fraction; ++it) {
+                bad |= digit(it) > 9;
+                value = value * 10 + digit(it);
+            }
+            f.fraction = value;
+            f.has_fraction = !bad;
+        }
+        return true;
+    }
+
+#if LAZY_X86
+    // 16-bit lane i = 10 * byte[2i] + byte[2i + 1]
+    static inline __m128i pairs_sse2(__m128i d) {
+        const __m128i lo = _mm_and_si128(d, _mm_set1_epi16(0x00ff));
+        const __m128i hi = _mm_srli_epi16(d, 8);
+        return _mm_add_epi16(_mm_mullo_epi16(lo, _mm_set1_epi16(10)), hi);
+    }
+
+    static inline int digits_sse2(__m128i d) {
+        const __m128i nine = _mm_set1_epi8(9);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine));
+    }
+
+    // fraction digits sit at [10, 16) of the load at ptr + 10, i.e. lanes 5..7
+    static inline void fraction_sse2(const char* ptr, const char* ptr_end, fixed_datetime_t& f) {
+        f.has_fraction = false;
+        if (!fraction_bounds(ptr, ptr_end)) return;
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 10));
+        const __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+        if ((digits_sse2(d) & 0xFC00) != 0xFC00) return;
+        const __m128i v = pairs_sse2(d);
+        f.fraction = static_cast<uint32_t>(_mm_extract_epi16(v, 5)) * 10000
+                   + static_cast<uint32_t>(_mm_extract_epi16(v, 6)) * 100
+                   + static_cast<uint32_t>(_mm_extract_epi16(v, 7));
+        f.has_fraction = true;
+    }
+
+    // a = bytes [0, 16), b = bytes [3, 19); month, hour and second are pair aligned in b
+    static inline bool sse2(const char* ptr, const char* ptr_end, fixed_datetime_t& f) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 3));
+        const __m128i da = _mm_sub_epi8(a, _mm_set1_epi8('0'));
+        const __m128i db = _mm_sub_epi8(b, _mm_set1_epi8('0'));
+        const __m128i dash  = _mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, ' ', 0, 0, ':', 0, 0);
+        const __m128i slash = _mm_setr_epi8(0, 0, 0, 0, '/', 0, 0, '/', 0, 0, ' ', 0, 0, ':', 0, 0);
+        const int seps_a = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(a, dash), _mm_cmpeq_epi8(a, slash)));
+        const int seps_b = _mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8(':')));
+        if (((digits_sse2(da) & 0xDB6F) | (seps_a & 0x2490)) != 0xFFFF) return false;
+        if (((digits_sse2(db) & 0xC000) | (seps_b & 0x2000)) != 0xE000) return false;
+        const __m128i va = pairs_sse2(da);
+        const __m128i vb = pairs_sse2(db);
+        f.year = static_cast<uint32_t>(_mm_extract_epi16(va, 0)) * 100 + _mm_extract_epi16(va, 1);
+        f.mday = _mm_extract_epi16(va, 4);
+        f.min  = _mm_extract_epi16(va, 7);
+        f.mon  = _mm_extract_epi16(vb, 1);
+        f.hour = _mm_extract_epi16(vb, 4);
+        f.sec  = _mm_extract_epi16(vb, 7);
+        fraction_sse2(ptr, ptr_end, f);
+        return true;
+    }
+
+    // the same two loads as sse2, checked and converted as one 32-byte register
+    LAZY_TARGET_AVX2 static inline bool avx2(const char* ptr, const char* ptr_end, fixed_datetime_t& f) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 3));
+        const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+        const __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        const __m256i nine = _mm256_set1_epi8(9);
+        const __m256i dash  = _mm256_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, ' ', 0, 0, ':', 0, 0,
+                                               0, 0, 0, 0,  0,  0, 0,  0,  0, 0,  0,  0, 0, ':', 0, 0);
+        const __m256i slash = _mm256_setr_epi8(0, 0, 0, 0, '/', 0, 0, '/', 0, 0, ' ', 0, 0, ':', 0, 0,
+                                               0, 0, 0, 0,  0,  0, 0,  0,  0, 0,  0,  0, 0, ':', 0, 0);
+        const uint32_t digits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(d, nine), nine)));
+        const uint32_t seps = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, dash), _mm256_cmpeq_epi8(v, slash))));
+        const uint32_t digits_mask = 0xC000DB6Fu, seps_mask = 0x20002490u;
+        if (((digits & digits_mask) | (seps & seps_mask)) != (digits_mask | seps_mask)) return false;
+        alignas(32) uint16_t lanes[16];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_maddubs_epi16(d, _mm256_set1_epi16(0x010A)));
+        f.year = static_cast<uint32_t>(lanes[0]) * 100 + lanes[1];
+        f.mday = lanes[4];
+        f.min  = lanes[7];
+        f.mon  = lanes[9];
+        f.hour = lanes[12];
+        f.sec  = lanes[15];
+        fraction_sse2(ptr, ptr_end, f);
+        return true;
+    }
+#endif
+
+    using fn_t = bool (*)(const char*, const char*, fixed_datetime_t&);
+
+    static inline fn_t select() {
+#if LAZY_X86
+        switch (cpu::level()) {
+            case cpu::level_t::AVX2: return &avx2;
+            case cpu::level_t::SSE2: return &sse2;
+            default: break;
+        }
+#endif
+        return &scalar;
+    }
+
+    static inline bool parse(const char* ptr, const char* ptr_end, fixed_datetime_t& f) {
+#if defined(__AVX2__)
+        return avx2(ptr, ptr_end, f);
+#else
+        static const fn_t fn = select();
+        return fn(ptr, ptr_end, f);
+#endif
+    }
+};
+
+// the parts of grammar_generic which follow the seconds, see grammar_generic
+using grammar_generic_tz             = op_maybe<op_seq<op_or<term_tz_sing<'+'>, term_tz_sing<'-'>>, grammar_tz_offset>>;
+using grammar_generic_after_sec      = op_seq<op_maybe<op_seq<term_fraction, grammar_generic_tz>>, grammar_generic_tz>;
+using grammar_generic_after_fraction = op_seq<grammar_generic_tz, grammar_generic_tz>;
+
+// speculative fixed layout kernel in front of grammar_generic; the kernel only
+// accepts input on which grammar_generic takes the very same path, so handlers
+// see identical calls in identical order. Checked is the validated<> variant:
+// the handlers are checked<> and a value out of range sends the input back to
+// validated<grammar_generic>, which stops at the same field.
+template <bool Checked>
+struct grammar_generic_fast_t {
+    template <typename Handler> using handler = typename std::conditional<Checked, checked<Handler>, Handler>::type;
+    using fallback = typename std::conditional<Checked, validated<grammar_generic>, grammar_generic>::type;
+    using after_sec = typename std::conditional<Checked, validated<grammar_generic_after_sec>, grammar_generic_after_sec>::type;
+    using after_fraction = typename std::conditional<Checked, validated<grammar_generic_after_fraction>, grammar_generic_after_fraction>::type;
+
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        fixed_datetime_t f;
+        if (ptr_end - ptr >= kernel_datetime::size && kernel_datetime::parse(ptr, ptr_end, f)) {
+            const bool ok = invoke_handler<handler<handler_year_v>>(static_cast<int>(f.year), 4, ctx)
+                && invoke_handler<handler<handler_month>>(static_cast<int>(f.mon), ctx)
+                && invoke_handler<handler<handler_day>>(static_cast<int>(f.mday), ctx)
+                && invoke_handler<handler<handler_hour_v>>(static_cast<int>(f.hour), 2, ctx)
+                && invoke_handler<handler<handler_minute_v>>(static_cast<int>(f.min), 2, ctx)
+                && invoke_handler<handler<handler_second_v>>(static_cast<int>(f.sec), 2, ctx);
+            if (!ok) return fallback::parse(ptr, ptr_end, ctx);
+            if (f.has_fraction) {
+                invoke_handler<handler<handler_fraction>>(static_cast<int>(f.fraction), 6, ctx);
+                return after_fraction::parse(ptr + kernel_datetime::size_fraction, ptr_end, ctx);
+            }
+            return after_sec::parse(ptr + kernel_datetime::size, ptr_end, ctx);
+        }
+        return fallback::parse(ptr, ptr_end, ctx);
+    }
+};
+
+using grammar_generic_fast = grammar_generic_fast_t<false>;
+
+template <> struct validate<grammar_generic_fast_t<false>> { using type = grammar_generic_fast_t<true>; };
+
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "iso8601.hpp"
+
+namespace parser {
+
+// A grammar lowered at compile time into a flat instruction table, driven by
+// a single loop. Alternatives keep their ordered (PEG) semantics through a
+// small backtrack stack, so the handlers fire exactly as in the recursive
+// version: op_or<A, B> is CHOICE; A; COMMIT; B and op_maybe<T> is op_or<T, empty>.
+// The handlers are bound to the context type, so there is one table per
+// grammar and context.
+
+enum class opcode_t : uint8_t { CHAR, NUMBER, VAR_NUMBER, KEYWORD, CHOICE, COMMIT, ACCEPT };
+
+template <typename Context>
+using action_t = bool (*)(int value, int count, Context& ctx);           // false rejects the value
+
+template <typename Context>
+struct instruction_t {
+    opcode_t op;
+    char arg;                                       // char to match, digits or keyword bytes count
+    int16_t jump;                                   // CHOICE/COMMIT, relative to the instruction
+    action_t<Context> action;                       // may be NULL
+};
+
+template <typename Handler, typename Context> struct action {
+    static bool fixed(int value, int, Context& ctx) { return invoke_handler<Handler>(value, ctx); }
+    static bool var(int value, int count, Context& ctx) { return invoke_handler<Handler>(value, count, ctx); }
+};
+
+// size: instructions count, depth: backtrack stack usage, at(i): i-th instruction
+template <typename T, typename Context> struct lower;
+
+template <char C, typename Handler, typename Context> struct lower<term_char<C, Handler>, Context> {
+    static constexpr std::size_t size() { return 1; }
+    static constexpr std::size_t depth() { return 0; }
+    static constexpr instruction_t<Context> at(std::size_t) { return instruction_t<Context>{opcode_t::CHAR, C, 0, &action<Handler, Context>::fixed}; }
+};
+template <char C, typename Context> struct lower<term_char<C, void>, Context> {
+    static constexpr std::size_t size() { return 1; }
+    static constexpr std::size_t depth() { return 0; }
+    static constexpr instruction_t<Context> at(std::size_t) { return instruction_t<Context>{opcode_t::CHAR, C, 0, nullptr}; }
+};
+template <int N, typename Handler, typename Context> struct lower<term_number<N, Handler>, Context> {
+    static constexpr std::size_t size() { return 1; }
+    static constexpr std::size_t depth() { return 0; }
+    static constexpr instruction_t<Context> at(std::size_t) { return instruction_t<Context>{opcode_t::NUMBER, N, 0, &action<Handler, Context>::fixed}; }
+};
+template <int N, typename Handler, typename Context> struct lower<term_var_number<N, Handler>, Context> {
+    static constexpr std::size_t size() { return 1; }
+    static constexpr std::size_t depth() { return 0; }
+    static constexpr instruction_t<Context> at(std::size_t) { return instruction_t<Context>{opcode_t::VAR_NUMBER, N, 0, &action<Handler, Context>::var}; }
+};
+
+template <typename T, typename Context> struct lower<op_seq<T>, Context>: lower<T, Context> {};
+template <typename T, typename ...Ts, typename Context> struct lower<op_seq<T, Ts...>, Context> {
+    using head = lower<T, Context>;
+    using tail = lower<op_seq<Ts...>, Context>;
+    static constexpr std::size_t size() { return head::size() + tail::size(); }
+    static constexpr std::size_t depth() { return head::depth() > tail::depth() ? head::depth() : tail::depth(); }
+    static constexpr instruction_t<Context> at(std::size_t i) { return i < head::size() ? head::at(i) : tail::at(i - head::size()); }
+};
+
+template <typename T, typename Context> struct lower<op_or<T>, Context>: lower<T, Context> {};
+template <typename T, typename ...Ts, typename Context> struct lower<op_or<T, Ts...>, Context> {
+    using head = lower<T, Context>;
+    using tail = lower<op_or<Ts...>, Context>;
+    static constexpr std::size_t size() { return head::size() + tail::size() + 2; }
+    static constexpr std::size_t depth() { return head::depth() + 1 > tail::depth() ? head::depth() + 1 : tail::depth(); }
+    static constexpr instruction_t<Context> at(std::size_t i) {
+        return i == 0                   ? instruction_t<Context>{opcode_t::CHOICE, 0, static_cast<int16_t>(head::size() + 2), nullptr}
+             : i <= head::size()        ? head::at(i - 1)
+             : i == head::size() + 1    ? instruction_t<Context>{opcode_t::COMMIT, 0, static_cast<int16_t>(tail::size() + 1), nullptr}
+             :                            tail::at(i - head::size() - 2);
+    }
+};
+
+template <typename ...Ts, typename Context> struct lower<op_maybe<Ts...>, Context> {
+    using body = lower<op_or<Ts...>, Context>;
+    static constexpr std::size_t size() { return body::size() + 2; }
+    static constexpr std::size_t depth() { return body::depth() + 1; }
+    static constexpr instruction_t<Context> at(std::size_t i) {
+        return i == 0                   ? instruction_t<Context>{opcode_t::CHOICE, 0, static_cast<int16_t>(body::size() + 2), nullptr}
+             : i <= body::size()        ? body::at(i - 1)
+             :                            instruction_t<Context>{opcode_t::COMMIT, 0, 1, nullptr};
+    }
+};
+
+template <typename G, typename Context, typename Indices = typename make_index_list<lower<G, Context>::size()>::type>
+struct program;
+template <typename G, typename Context, std::size_t... Is> struct program<G, Context, index_list<Is...>> {
+    static constexpr std::size_t depth = lower<G, Context>::depth();
+    static constexpr instruction_t<Context> code[sizeof...(Is) + 1] = {
+        lower<G, Context>::at(Is)..., instruction_t<Context>{opcode_t::ACCEPT, 0, 0, nullptr}
+    };
+};
+template <typename G, typename Context, std::size_t... Is>
+constexpr instruction_t<Context> program<G, Context, index_list<Is...>>::code[sizeof...(Is) + 1];
+
+template <typename G>
+struct flat {
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        using code = program<G, Context>;
+        struct frame_t { const instruction_t<Context>* pc; const char* ptr; };
+        frame_t stack[code::depth + 1];
+        frame_t* top = stack;
+        const instruction_t<Context>* pc = code::code;
+        for (;;) {
+            switch (pc->op) {
+            case opcode_t::CHAR:
+                if (ptr != ptr_end && *ptr == pc->arg) {
+                    if (pc->action && !pc->action(pc->arg, 1, ctx)) break;
+                    ++ptr;
+                    ++pc;
+                    continue;
+                }
+                break;
+            case opcode_t::NUMBER: {
+                const char* number_end = ptr + pc->arg;
+                if (number_end > ptr_end) break;
+                int value = 0;
+                const char* it = ptr;
+                for (; it != number_end; ++it) {
+                    const unsigned digit = static_cast<unsigned>(*it - '0');
+                    if (digit > 9) break;
+                    value = value * 10 + static_cast<int>(digit);
+                }
+                if (it != number_end || !pc->action(value, pc->arg, ctx)) break;
+                ptr = number_end;
+                ++pc;
+                continue;
+            }
+            case opcode_t::VAR_NUMBER: {
+                const char* number_end = std::min(ptr + pc->arg, ptr_end);
+                int value = 0;
+                const char* it = ptr;
+                for (; it != number_end; ++it) {
+                    const unsigned digit = static_cast<unsigned>(*it - '0');
+                    if (digit > 9) break;
+                    value = value * 10 + static_cast<int>(digit);
+                }
+                if (it == ptr || !pc->action(value, static_cast<int>(it - ptr), ctx)) break;
+                ptr = it;
+                ++pc;
+                continue;
+            }
+            case opcode_t::KEYWORD: {
+                // packed as keyword_table::pack does, the action looks the key up
+                const char* keyword_end = ptr + pc->arg;
+                if (keyword_end > ptr_end) break;
+                uint32_t key = 0;
+                for (const char* it = ptr; it != keyword_end; ++it) key = key << 8 | (static_cast<uint8_t>(*it) | 0x20);
+                if (!pc->action(static_cast<int>(key), pc->arg, ctx)) break;
+                ptr = keyword_end;
+                ++pc;
+                continue;
+            }
+            case opcode_t::CHOICE:
+                *(top++) = frame_t{pc + pc->jump, ptr};
+                ++pc;
+                continue;
+            case opcode_t::COMMIT:
+                --top;
+                pc += pc->jump;
+                continue;
+            case opcode_t::ACCEPT:
+                return ptr;
+            }
+            // failure: resume the most recent pending alternative
+            if (top == stack) return NULL;
+            --top;
+            pc = top->pc;
+            ptr = top->ptr;
+        }
+    }
+};
+
+}
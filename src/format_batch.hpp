@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "cpu.hpp"
+#include "column.hpp"
+#include "epoch.hpp"
+#include "formatter.hpp"
+
+// one row at a time through the patcher of E, the kernel of every expression
+template <typename E>
+struct batch_rows {
+    static const auto N = E::N;
+    static const std::size_t stride = N + 1;
+
+    static inline bool row(const datetime& dt, char* out, char delim) {
+        if (!E::FinalPatcher::fits(dt)) return false;
+        std::memcpy(out, E::literal::value, N);
+        E::FinalPatcher::fn(out, dt);
+        out[N] = delim;
+        return true;
+    }
+
+    static inline std::size_t apply(const datetime* in, std::size_t count, char* out, char delim) {
+        for (std::size_t i = 0; i < count; ++i, out += stride) {
+            if (!row(in[i], out, delim)) return i;
+        }
+        return count;
+    }
+};
+
+// the rows of E, vectorized for the expressions which have a kernel
+template <typename E> struct batch_kernel: batch_rows<E> {};
+
+// iso_t 4 values per iteration, 2 per 256-bit register and 1 per 128-bit lane:
+// the fields are packed to 16-bit lanes, the year split in two, every lane
+// turned to 2 ASCII digits with multiplies and the row put in place by a byte
+// shuffle over the separators. The scalar rows are the fallback for the other
+// CPUs and for the values with a 2-digit field out of [0, 99].
+template <>
+struct batch_kernel<iso_t> {
+    static const std::size_t stride = iso_t::N + 1;
+
+    static inline std::size_t scalar(const datetime* in, std::size_t count, char* out, char delim) {
+        return batch_rows<iso_t>::apply(in, count, out, delim);
+    }
+
+#if LAZY_X86
+    // [year, mon, mday, hour, min, sec, 0, 0] of two values in 16-bit lanes;
+    // the signed saturation keeps the negative and the huge values out of range
+    LAZY_TARGET_AVX2 static inline __m256i pack(const datetime* in) {
+        const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in[0]));
+        const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in[1]));
+        const __m128i b0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&in[0].min));
+        const __m128i b1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&in[1].min));
+        return _mm256_packs_epi32(_mm256_setr_m128i(a0, a1), _mm256_setr_m128i(b0, b1));
+    }
+
+    // non-zero unless the years fit 4 digits and the other fields 2
+    LAZY_TARGET_AVX2 static inline __m256i over(__m256i packed) {
+        const __m256i limit = _mm256_setr_epi16(9999, 99, 99, 99, 99, 99, 0, 0, 9999, 99, 99, 99, 99, 99, 0, 0);
+        return _mm256_xor_si256(_mm256_max_epu16(packed, limit), limit);
+    }
+
+    // two packed values to two rows, tail_seps is ":" 0 0 delim in both lanes
+    LAZY_TARGET_AVX2 static inline void render(__m256i packed, __m256i tail_seps, char* out) {
+        // [year, year, mon, mday, hour, min, sec, 0] per lane
+        const __m256i split = _mm256_setr_epi8(0, 1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+                                               0, 1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13);
+        const __m256i v = _mm256_shuffle_epi8(packed, split);
+        // y / 100 = ((y >> 2) * 5243) >> 17 for y < 43699, then [y / 100, y % 100, ...]
+        const __m256i hundreds = _mm256_srli_epi16(_mm256_mulhi_epu16(_mm256_srli_epi16(v, 2), _mm256_set1_epi16(5243)), 1);
+        const __m256i rest = _mm256_sub_epi16(v, _mm256_mullo_epi16(hundreds,
+            _mm256_setr_epi16(0, 100, 0, 0, 0, 0, 0, 0, 0, 100, 0, 0, 0, 0, 0, 0)));
+        const __m256i values = _mm256_blend_epi16(rest, hundreds, 0x01);
+        // v / 10 = (v * 6554) >> 16 for v < 100, tens in the low byte
+        const __m256i tens = _mm256_mulhi_epu16(values, _mm256_set1_epi16(6554));
+        const __m256i ones = _mm256_sub_epi16(values, _mm256_mullo_epi16(tens, _mm256_set1_epi16(10)));
+        const __m256i ascii = _mm256_or_si256(_mm256_or_si256(tens, _mm256_slli_epi16(ones, 8)), _mm256_set1_epi16(0x3030));
+        // "YYYYMMDDHHMMSS" to "YYYY-MM-DD HH:MM" and ":SS" + delim
+        const char x = static_cast<char>(0x80);
+        const __m256i head_index = _mm256_setr_epi8(0, 1, 2, 3, x, 4, 5, x, 6, 7, x, 8, 9, x, 10, 11,
+                                                    0, 1, 2, 3, x, 4, 5, x, 6, 7, x, 8, 9, x, 10, 11);
+        const __m256i head_seps = _mm256_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, ' ', 0, 0, ':', 0, 0,
+                                                   0, 0, 0, 0, '-', 0, 0, '-', 0, 0, ' ', 0, 0, ':', 0, 0);
+        const __m256i tail_index = _mm256_setr_epi8(x, 12, 13, x, x, x, x, x, x, x, x, x, x, x, x, x,
+                                                    x, 12, 13, x, x, x, x, x, x, x, x, x, x, x, x, x);
+        const __m256i head = _mm256_or_si256(_mm256_shuffle_epi8(ascii, head_index), head_seps);
+        const __m256i tail = _mm256_or_si256(_mm256_shuffle_epi8(ascii, tail_index), tail_seps);
+        const uint32_t tail0 = static_cast<uint32_t>(_mm256_extract_epi32(tail, 0));
+        const uint32_t tail1 = static_cast<uint32_t>(_mm256_extract_epi32(tail, 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(head));
+        std::memcpy(out + 16, &tail0, 4);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + stride), _mm256_extracti128_si256(head, 1));
+        std::memcpy(out + stride + 16, &tail1, 4);
+    }
+
+    LAZY_TARGET_AVX2 static inline std::size_t avx2(const datetime* in, std::size_t count, char* out, char delim) {
+        const __m256i tail_seps = _mm256_set1_epi32(':' | static_cast<int>(static_cast<unsigned char>(delim)) << 24);
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4, out += 4 * stride) {
+            const __m256i v0 = pack(in + i), v1 = pack(in + i + 2);
+            const __m256i bad = _mm256_or_si256(over(v0), over(v1));
+            if (!_mm256_testz_si256(bad, bad)) {
+                const std::size_t written = scalar(in + i, 4, out, delim);
+                if (written != 4) return i + written;
+                continue;
+            }
+            render(v0, tail_seps, out);
+            render(v1, tail_seps, out + 2 * stride);
+        }
+        return i + scalar(in + i, count - i, out, delim);
+    }
+#endif
+
+    using fn_t = std::size_t (*)(const datetime*, std::size_t, char*, char);
+
+    static inline fn_t select() {
+#if LAZY_X86
+        if (cpu::level() == cpu::level_t::AVX2) return &avx2;
+#endif
+        return &scalar;
+    }
+
+    static inline std::size_t apply(const datetime* in, std::size_t count, char* out, char delim) {
+        static const fn_t fn = select();
+        return fn(in, count, out, delim);
+    }
+};
+
+// renders arrays of values into one contiguous buffer at a fixed stride of
+// E::N + 1 bytes, each row followed by delim ('\n', '\0', ...). Stops at the
+// first value which does not fit the fixed layout, returns the rows written.
+template <typename E>
+struct batch_expression_t {
+    static const std::size_t stride = E::N + 1;
+
+    static inline std::size_t apply(const datetime* in, std::size_t count, char* out, char delim) {
+        return batch_kernel<E>::apply(in, count, out, delim);
+    }
+
+    // epochs are split into fields block by block, the fraction is dropped
+    static inline std::size_t apply(const parser::epoch_t* in, std::size_t count, char* out, char delim) {
+        const std::size_t block = 64;
+        datetime dt[block];
+        for (std::size_t base = 0; base < count; base += block) {
+            const std::size_t n = std::min(block, count - base);
+            for (std::size_t i = 0; i < n; ++i) {
+                parser::microsec_t mksec;
+                parser::civil::from_epoch(in[base + i], dt[i], mksec);
+            }
+            const std::size_t written = batch_kernel<E>::apply(dt, n, out + base * stride, delim);
+            if (written != n) return base + written;
+        }
+        return count;
+    }
+
+    // straight from a column, block by block, at the offset each value was
+    // parsed with, i.e. the wall time which was parsed; the fraction is dropped
+    static inline std::size_t apply(const parser::column_t& in, char* out, char delim) {
+        const std::size_t block = parser::column_t::block_size;
+        parser::epoch_t values[block];
+        int16_t offsets[block];
+        datetime dt[block];
+        for (std::size_t b = 0; b < in.block_count(); ++b) {
+            const std::size_t n = in.decode(b, values, offsets);
+            for (std::size_t i = 0; i < n; ++i) {
+                const int64_t shift = offsets[i] == parser::column_t::local ? 0 : offsets[i] * int64_t(60000000);
+                parser::microsec_t mksec;
+                parser::civil::from_epoch(values[i] + shift, dt[i], mksec);
+            }
+            const std::size_t written = batch_kernel<E>::apply(dt, n, out + b * block * stride, delim);
+            if (written != n) return b * block + written;
+        }
+        return in.size();
+    }
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include "iso8601.hpp"
+
+// reentrant digit writers, two digits per table lookup
+struct digits {
+    static inline const char* pairs() {
+        static const char table[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        return table;
+    }
+
+    // value must be in [0, 99]
+    static inline char* write2(char* out, uint32_t value) {
+        std::memcpy(out, pairs() + value * 2, 2);
+        return out + 2;
+    }
+
+    // value must be in [0, 9999]
+    static inline char* write4(char* out, uint32_t value) {
+        const uint32_t hi = value / 100;
+        write2(out, hi);
+        return write2(out + 2, value - hi * 100);
+    }
+
+    // any value, no padding
+    static inline char* write(char* out, int64_t value) {
+        char buf[20];
+        char* p = buf + sizeof(buf);
+        uint64_t u = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        while (u >= 100) {
+            const uint64_t q = u / 100;
+            p -= 2;
+            std::memcpy(p, pairs() + (u - q * 100) * 2, 2);
+            u = q;
+        }
+        if (u >= 10) {
+            p -= 2;
+            std::memcpy(p, pairs() + u * 2, 2);
+        } else {
+            *--p = static_cast<char>('0' + u);
+        }
+        if (value < 0) *(out++) = '-';
+        const auto len = buf + sizeof(buf) - p;
+        std::memcpy(out, p, len);
+        return out + len;
+    }
+};
+
+// compile-time literal, the constant part of a fixed layout format
+template <char... Cs> struct chars {
+    static constexpr char value[sizeof...(Cs) + 1] = {Cs..., 0};
+};
+template <char... Cs> constexpr char chars<Cs...>::value[sizeof...(Cs) + 1];
+
+template <typename ...Ts> struct concat;
+template <> struct concat<> { using type = chars<>; };
+template <char... Cs> struct concat<chars<Cs...>> { using type = chars<Cs...>; };
+template <char... As, char... Bs, typename ...Ts> struct concat<chars<As...>, chars<Bs...>, Ts...> {
+    using type = typename concat<chars<As..., Bs...>, Ts...>::type;
+};
+
+template <std::size_t N, char... Cs> struct zeros { using type = typename zeros<N - 1, '0', Cs...>::type; };
+template <char... Cs> struct zeros<0, Cs...> { using type = chars<Cs...>; };
+
+// every tag renders to a fixed N bytes slot on top of its pattern when fits(dt),
+// patch() writes only the bytes which differ from the pattern, changed() tells
+// whether the slot differs between two values
+template <std::size_t N>
+struct tag_t: std::integral_constant<std::size_t, N>{
+    using pattern = typename zeros<N>::type;
+
+    inline static bool fits(const datetime&) { return true; }
+    inline static bool changed(const datetime&, const datetime&) { return true; }
+
+    // 2-digit fields always take exactly 2 bytes, out of range values are cut to the last 2 digits
+    inline static char* apply2(char* in, uint32_t value) {
+        return digits::write2(in, value < 100 ? value : value % 100);
+    }
+};
+
+struct tag_year     : tag_t<4> {
+    inline static bool fits(const datetime& dt) { return dt.year >= 0 && dt.year <= 9999; }
+    inline static bool changed(const datetime& a, const datetime& b) { return a.year != b.year; }
+    inline static void patch(char* in, const datetime& dt) { digits::write4(in, dt.year); }
+    inline static char* apply(char* in, datetime& dt) {
+        if (fits(dt)) return digits::write4(in, dt.year);
+        return digits::write(in, dt.year);
+    }
+};
+struct tag_month    : tag_t<2> {
+    inline static bool changed(const datetime& a, const datetime& b) { return a.mon != b.mon; }
+    inline static void patch(char* in, const datetime& dt) { apply2(in, dt.mon); }
+    inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.mon); }
+};
+struct tag_day      : tag_t<2> {
+    inline static bool changed(const datetime& a, const datetime& b) { return a.mday != b.mday; }
+    inline static void patch(char* in, const datetime& dt) { apply2(in, dt.mday); }
+    inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.mday); }
+};
+struct tag_hour     : tag_t<2> {
+    inline static bool changed(const datetime& a, const datetime& b) { return a.hour != b.hour; }
+    inline static void patch(char* in, const datetime& dt) { apply2(in, dt.hour); }
+    inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.hour); }
+};
+struct tag_min      : tag_t<2> {
+    inline static bool changed(const datetime& a, const datetime& b) { return a.min != b.min; }
+    inline static void patch(char* in, const datetime& dt) { apply2(in, dt.min); }
+    inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.min); }
+};
+struct tag_sec      : tag_t<2> {
+    inline static bool changed(const datetime& a, const datetime& b) { return a.sec != b.sec; }
+    inline static void patch(char* in, const datetime& dt) { apply2(in, dt.sec); }
+    inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.sec); }
+};
+struct tag_ampm     : tag_t<2> {
+    using pattern = chars<'A', 'M'>;
+    inline static bool changed(const datetime& a, const datetime& b) { return (a.hour < 12) != (b.hour < 12); }
+    inline static void patch(char* in, const datetime& dt) { *in = dt.hour < 12 ? 'A' : 'P'; }
+    inline static char* apply(char* in, datetime& dt) {
+        *(in++) = dt.hour < 12 ? 'A' : 'P';
+        *(in++) = 'M';
+        return in;
+    }
+};
+
+template <char C>
+struct tag_char : tag_t<1> {
+    using pattern = chars<C>;
+    inline static bool changed(const datetime&, const datetime&) { return false; }
+    inline static void patch(char*, const datetime&) {}
+    inline static char* apply(char* in, datetime&) {
+        *in = C;
+        return ++in;
+    }
+};
+
+
+template <typename ...Ts> struct size_of_t;
+template <typename T> struct size_of_t<T> { static const auto Value = T::value; };
+template <typename T, typename ...Ts> struct size_of_t<T, Ts ...> {
+    static const auto Value = (size_of_t<T>::Value + size_of_t<Ts...>::Value);
+};
+
+template <typename ... Tags> struct Composer;
+template <typename T1> struct Composer<T1> {
+    static char* fn(char* in, datetime& dt) {
+        return T1::apply(in, dt);
+    }
+    static char* compose(char* in, datetime& dt) {
+        return fn(in, dt);
+    }
+};
+template <typename T, typename ...Tags> struct Composer<T, Tags...> {
+    static char* fn(char* in, datetime& dt) {
+        return Composer<Tags...>::fn(Composer<T>::fn(in, dt), dt);
+    }
+    static char* compose(char* in, datetime& dt) {
+        return fn(in, dt);
+    }
+};
+
+// fixed layout: every tag at a compile-time offset of the same buffer
+template <std::size_t Offset, typename ... Tags> struct Patcher;
+template <std::size_t Offset> struct Patcher<Offset> {
+    static inline bool fits(const datetime&) { return true; }
+    static inline void fn(char*, const datetime&) {}
+    static inline void update(char*, const datetime&, const datetime&) {}
+};
+template <std::size_t Offset, typename T, typename ...Tags> struct Patcher<Offset, T, Tags...> {
+    static inline bool fits(const datetime& dt) {
+        return T::fits(dt) && Patcher<Offset + T::value, Tags...>::fits(dt);
+    }
+    static inline void fn(char* in, const datetime& dt) {
+        T::patch(in + Offset, dt);
+        Patcher<Offset + T::value, Tags...>::fn(in, dt);
+    }
+    // patches only the slots which differ from the previously rendered value
+    static inline void update(char* in, const datetime& prev, const datetime& dt) {
+        if (T::changed(prev, dt)) T::patch(in + Offset, dt);
+        Patcher<Offset + T::value, Tags...>::update(in, prev, dt);
+    }
+};
+
+template <typename ...Args>
+struct expression_t {
+    static const auto N  = size_of_t<Args...>::Value;
+    using FinalComposer = Composer<Args...>;
+    using FinalPatcher = Patcher<0, Args...>;
+    using literal = typename concat<typename Args::pattern...>::type;
+
+    // one memcpy of the literal plus constant offset stores of the digits,
+    // the chained composer only for values which do not fit their slot;
+    // fields are read from a copy, as stores through in may alias dt
+    inline static char* apply(char* in, datetime& dt) {
+        const datetime value = dt;
+        if (FinalPatcher::fits(value)) {
+            std::memcpy(in, literal::value, N);
+            FinalPatcher::fn(in, value);
+            return in + N;
+        }
+        return FinalComposer::compose(in,dt);
+    }
+};
+
+using iso_t = expression_t<
+    tag_year, tag_char<'-'>, tag_month, tag_char<'-'>, tag_day, tag_char<' '>,
+    tag_hour, tag_char<':'>, tag_min, tag_char<':'>, tag_sec
+>;
+
+
+// keeps the last rendered value and rewrites only the slots which changed
+// since, i.e. the seconds for monotonic streams and the date on day rollover.
+// Not thread-safe: meant to be one instance per thread.
+template <typename E> struct cached_expression_t;
+template <typename ...Args>
+struct cached_expression_t<expression_t<Args...>> {
+    using expression = expression_t<Args...>;
+    static const auto N = expression::N;
+
+    cached_expression_t(): last {0, 0, 0, 0, 0, 0}, valid{false} {}
+
+    inline char* apply(char* in, datetime& dt) {
+        const datetime value = dt;
+        if (!expression::FinalPatcher::fits(value)) {
+            valid = false;
+            return expression::apply(in, dt);
+        }
+        if (!valid) {
+            std::memcpy(buff, expression::literal::value, N);
+            expression::FinalPatcher::fn(buff, value);
+            valid = true;
+        } else if (std::memcmp(&last, &value, sizeof(datetime))) {
+            expression::FinalPatcher::update(buff, last, value);
+        }
+        last = value;
+        std::memcpy(in, buff, N);
+        return in + N;
+    }
+
+private:
+    char buff[N];
+    datetime last;
+    bool valid;
+};
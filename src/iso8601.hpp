@@ -1,5 +1,9 @@
+#pragma once
+
 #include <algorithm>
-#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
 struct datetime {
     int32_t year;
@@ -13,10 +17,11 @@ struct datetime {
 
 namespace parser {
 
-enum class time_unit_t { NONE = 0, H, M, S};
-enum class tz_info_t { LOCAL, UTC };
+enum class time_unit_t : uint8_t { NONE = 0, H, M, S};
+enum class tz_info_t : uint8_t { LOCAL, UTC };
 
 using microsec_t = uint32_t;
+using nanosec_t = uint32_t;
 
 struct timezone_t {
     tz_info_t tz_info;
@@ -33,90 +38,163 @@ struct context_t {
     uint32_t week;
     uint32_t week_day;
     time_unit_t time_unit;
+    nanosec_t* nsec;                                        // optional, full precision of the fraction
 };
 
+// Grammars and handlers take the context as a template parameter: any type
+// with the members of context_t works, whether they are references, values or
+// bit-fields; nsec may also be a value or nullptr (not kept). context_t stays
+// the default one, the two below own their fields, so the handlers store
+// straight into them and nothing has to be assumed about aliasing.
+
+struct value_context_t {
+    datetime dt;
+    microsec_t mksec;
+    timezone_t tz;
+    int32_t year_sign;
+    uint32_t week;
+    uint32_t week_day;
+    time_unit_t time_unit;
+    nanosec_t nsec;
+
+    // nothing parsed yet, local time
+    static inline value_context_t local() {
+        return value_context_t {{0, 0, 0, 0, 0, 0}, 0, { tz_info_t::LOCAL, 1, 0, 0 }, 1, 0, 0, time_unit_t::NONE, 0 };
+    }
+};
+
+// 16 bytes, every field as wide as its valid range: out of range values get
+// truncated, so it is meant for validated<G> (see validate.hpp)
+struct packed_context_t {
+    struct {
+        int32_t year;
+        uint32_t mon: 4, mday: 9, hour: 5, min: 6, sec: 6;  // mday holds ordinal days too
+    } dt;
+    uint32_t mksec: 20, week: 6, week_day: 3;
+    int32_t year_sign: 2;
+    time_unit_t time_unit: 2;
+    struct {
+        tz_info_t tz_info: 1;
+        int16_t sign: 2;
+        uint16_t hour: 5, minute: 6;
+    } tz;
+    static constexpr std::nullptr_t nsec = nullptr;
+};
+static_assert(sizeof(packed_context_t) == 16, "packed_context_t is expected to take 16 bytes");
+
+static inline uint32_t pow10(int n) {
+    static const uint32_t table[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+    return table[n];
+}
+
+static inline void store_nsec(nanosec_t* nsec, nanosec_t value) { if (nsec) *nsec = value; }
+static inline void store_nsec(nanosec_t& nsec, nanosec_t value) { nsec = value; }
+static inline void store_nsec(std::nullptr_t, nanosec_t) {}
+
 // handlers
 
 struct handler_year_sign {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.year_sign = (value == '+') ? 1 : -1;
     }
 };
 
 struct handler_year {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.dt.year = value;
     }
 };
 
 struct handler_year_v {
-    static inline void handle(int value, int, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, int, Context& ctx) {
         ctx.dt.year = static_cast<int32_t>(ctx.year_sign * value);
     }
 };
 
 
 struct handler_month {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.dt.mon = value;
     }
 };
 
 struct handler_day {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
+        ctx.dt.mday = value;
+    }
+};
+
+struct handler_day_v {
+    template <typename Context>
+    static inline void handle(int value, int, Context& ctx) {
         ctx.dt.mday = value;
     }
 };
 
 struct handler_week {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.week = value;
     }
 };
 
 struct handler_week_day {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.week_day = value;
     }
 };
 
 struct handler_hour {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.time_unit = time_unit_t::H;
         ctx.dt.hour = value;
     }
 };
 
 struct handler_hour_v {
-    static inline void handle(int value, int, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, int, Context& ctx) {
         ctx.time_unit = time_unit_t::H;
         ctx.dt.hour = value;
     }
 };
 
 struct handler_minute {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.time_unit = time_unit_t::M;
         ctx.dt.min = value;
     }
 };
 
 struct handler_minute_v {
-    static inline void handle(int value, int, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, int, Context& ctx) {
         ctx.time_unit = time_unit_t::M;
         ctx.dt.min = value;
     }
 };
 
 struct handler_second {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.time_unit = time_unit_t::S;
         ctx.dt.sec = value;
     }
 };
 
 struct handler_second_v {
-    static inline void handle(int value, int, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, int, Context& ctx) {
         ctx.time_unit = time_unit_t::S;
         ctx.dt.sec = value;
     }
@@ -124,83 +202,173 @@ struct handler_second_v {
 
 
 struct handler_tz_utc {
-    static inline void handle(int, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int, Context& ctx) {
         ctx.tz.tz_info = tz_info_t::UTC;
     }
 };
 
 struct handler_tz_offset_sign {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.tz.tz_info = tz_info_t::UTC;
         ctx.tz.sign = (value == '+') ? 1 : -1;
     }
 };
 
 struct handler_tz_offset_hour {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.tz.tz_info = tz_info_t::UTC;
         ctx.tz.hour = value;
     }
 };
 
 struct handler_tz_offset_minute {
-    static inline void handle(int value, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
         ctx.tz.tz_info = tz_info_t::UTC;
         ctx.tz.minute = value;
     }
 };
 
+// value / 10^count of the last parsed unit, spread over the smaller units in integers
 struct handler_fraction {
-    static inline void handle(int value, int count, context_t& ctx) {
+    template <typename Context>
+    static inline void handle(int value, int count, Context& ctx) {
         if (value) {
-            double share = value / std::pow(10, count);
+            const uint64_t share = static_cast<uint64_t>(value) * pow10(9 - count);    // in 1e-9 of the unit
+            uint64_t nsec;
             if (ctx.time_unit == time_unit_t::H) {
-                ctx.dt.min = (uint32_t)(share * 60);
-                //const double sec_left = (share * 3600) - ctx.dt.min * 60;
-                const double sec_left = (share - ((double)ctx.dt.min)/60) * 3600;
-                ctx.dt.sec = (uint32_t)sec_left;
-                const double mksec_left = (share * 3600) * 1000000 - (((double)(ctx.dt.min) * 60 * 1000000) + (double)(ctx.dt.sec) * 1000000);
-                ctx.mksec = (uint32_t)mksec_left;
+                const uint64_t total = share * 3600;
+                ctx.dt.min = static_cast<uint32_t>(total / 60000000000ull);
+                const uint64_t sec_left = total - ctx.dt.min * 60000000000ull;
+                ctx.dt.sec = static_cast<uint32_t>(sec_left / 1000000000);
+                nsec = sec_left - ctx.dt.sec * 1000000000ull;
             } else if (ctx.time_unit == time_unit_t::M) {
-                ctx.dt.sec = (uint32_t)(share * 60);
-                //const double mksec_left = (share * 1000000) - ctx.dt.min * 1000000;
-                const double mksec_left = (share - ((double)ctx.dt.sec)/60) * 1000000;
-                ctx.mksec = (uint32_t)mksec_left;
+                const uint64_t total = share * 60;
+                ctx.dt.sec = static_cast<uint32_t>(total / 1000000000);
+                nsec = total - ctx.dt.sec * 1000000000ull;
             } else if (ctx.time_unit == time_unit_t::S) {
-                ctx.mksec = (uint32_t)(share * 1000000);
+                nsec = share;
+            } else {
+                return;
             }
+            ctx.mksec = static_cast<microsec_t>(nsec / 1000);
+            store_nsec(ctx.nsec, static_cast<nanosec_t>(nsec));
+        } else {
+            store_nsec(ctx.nsec, 0);                // a reused context may hold the previous one
         }
     }
 };
 
 
-using handler_ordinal_date = handler_day;
+// day of year goes to mday with mon = 0 (a failed YYYYMMDD attempt may have set mon)
+struct handler_ordinal_date {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
+        ctx.dt.mon = 0;
+        ctx.dt.mday = value;
+    }
+};
+
+// Every node exposes nullable() (may succeed consuming nothing) and first(c)
+// (c may start a match), i.e. its FIRST set. When the FIRST sets of the
+// alternatives of op_or/op_maybe are disjoint the next byte selects the only
+// viable one through a 256-entry table; otherwise they are tried in order.
+
+template <std::size_t... Is> struct index_list {};
+template <std::size_t N, std::size_t... Is> struct make_index_list: make_index_list<N - 1, N - 1, Is...> {};
+template <std::size_t... Is> struct make_index_list<0, Is...> { using type = index_list<Is...>; };
+
+template <std::size_t I, typename ...Ts> struct alternatives;
+template <std::size_t I> struct alternatives<I> {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned) { return false; }
+    static constexpr bool disjoint() { return true; }
+    static constexpr unsigned index(unsigned) { return I; }
+    template <typename Context>
+    static inline const char* parse_at(unsigned, const char*, const char*, Context&) { return NULL; }
+};
+template <std::size_t I, typename T, typename ...Ts> struct alternatives<I, T, Ts...> {
+    using rest = alternatives<I + 1, Ts...>;
+    static constexpr bool nullable() { return T::nullable() || rest::nullable(); }
+    static constexpr bool first(unsigned c) { return T::first(c) || rest::first(c); }
+    static constexpr bool overlaps(unsigned c) { return c < 256 && ((T::first(c) && rest::first(c)) || overlaps(c + 1)); }
+    static constexpr bool disjoint() { return !T::nullable() && !overlaps(0) && rest::disjoint(); }
+    // index of the alternative which may start with c, past the last one if none
+    static constexpr unsigned index(unsigned c) { return T::first(c) ? I : rest::index(c); }
+    template <typename Context>
+    static inline const char* parse_at(unsigned index, const char* ptr, const char* ptr_end, Context& ctx) {
+        if (index == I) return T::parse(ptr, ptr_end, ctx);
+        return rest::parse_at(index, ptr, ptr_end, ctx);
+    }
+};
+
+template <typename Alternatives, typename Indices = typename make_index_list<256>::type> struct first_table;
+template <typename Alternatives, std::size_t... Is> struct first_table<Alternatives, index_list<Is...>> {
+    static constexpr uint8_t value[256] = { static_cast<uint8_t>(Alternatives::index(Is))... };
+
+    // disjoint alternatives only, ptr < ptr_end
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        return Alternatives::parse_at(value[static_cast<unsigned char>(*ptr)], ptr, ptr_end, ctx);
+    }
+};
+template <typename Alternatives, std::size_t... Is>
+constexpr uint8_t first_table<Alternatives, index_list<Is...>>::value[256];
+
+template <typename ...Ts> struct is_ll1 {
+    static const bool value = alternatives<0, Ts...>::disjoint();
+};
 
 // OR
 template <typename ...Ts> struct op_or;
+template <bool LL1, typename ...Ts> struct op_or_impl;
 template <typename T> struct op_or<T> {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+    static constexpr bool nullable() { return T::nullable(); }
+    static constexpr bool first(unsigned c) { return T::first(c); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         return T::parse(ptr, ptr_end, ctx);
     }
 };
-template <typename T, typename ...Ts> struct op_or<T, Ts...> {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+template <typename T, typename ...Ts> struct op_or<T, Ts...>: op_or_impl<is_ll1<T, Ts...>::value, T, Ts...> {
+    static constexpr bool nullable() { return T::nullable() || op_or<Ts...>::nullable(); }
+    static constexpr bool first(unsigned c) { return T::first(c) || op_or<Ts...>::first(c); }
+};
+template <typename T, typename ...Ts> struct op_or_impl<false, T, Ts...> {
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         const char* ptr_next = op_or<T>::parse(ptr, ptr_end, ctx);
         if (ptr_next) return ptr_next;
         return op_or<Ts...>::parse(ptr, ptr_end, ctx);
     }
 };
+template <typename ...Ts> struct op_or_impl<true, Ts...> {
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        if (ptr == ptr_end) return NULL;
+        return first_table<alternatives<0, Ts...>>::parse(ptr, ptr_end, ctx);
+    }
+};
 
 // SEQ
 
 template <typename ...Ts> struct op_seq;
 template <typename T> struct op_seq<T> {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+    static constexpr bool nullable() { return T::nullable(); }
+    static constexpr bool first(unsigned c) { return T::first(c); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         return T::parse(ptr, ptr_end, ctx);
     }
 };
 template <typename T, typename ...Ts> struct op_seq<T, Ts...> {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+    static constexpr bool nullable() { return T::nullable() && op_seq<Ts...>::nullable(); }
+    static constexpr bool first(unsigned c) { return T::first(c) || (T::nullable() && op_seq<Ts...>::first(c)); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         const char* ptr_next = op_seq<T>::parse(ptr, ptr_end, ctx);
         if (!ptr_next) return NULL;
         return op_seq<Ts...>::parse(ptr_next, ptr_end, ctx);
@@ -210,8 +378,12 @@ template <typename T, typename ...Ts> struct op_seq<T, Ts...> {
 // maybe
 
 template <typename ...Ts> struct op_maybe;
+template <bool LL1, typename ...Ts> struct op_maybe_impl;
 template <typename T> struct op_maybe<T> {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+    static constexpr bool nullable() { return true; }
+    static constexpr bool first(unsigned c) { return T::first(c); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         if (ptr < ptr_end) {
             const char* ptr_next = T::parse(ptr, ptr_end, ctx);
             return ptr_next ? ptr_next : ptr;
@@ -219,8 +391,13 @@ template <typename T> struct op_maybe<T> {
         return ptr;
     }
 };
-template <typename T, typename ...Ts> struct op_maybe<T, Ts...> {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+template <typename T, typename ...Ts> struct op_maybe<T, Ts...>: op_maybe_impl<is_ll1<T, Ts...>::value, T, Ts...> {
+    static constexpr bool nullable() { return true; }
+    static constexpr bool first(unsigned c) { return T::first(c) || op_maybe<Ts...>::first(c); }
+};
+template <typename T, typename ...Ts> struct op_maybe_impl<false, T, Ts...> {
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         if (ptr < ptr_end) {
             const char* ptr_next = T::parse(ptr, ptr_end, ctx);          // direct non-recursive call
             if (ptr_next >= ptr) return ptr_next;                        // stop chaining
@@ -229,15 +406,46 @@ template <typename T, typename ...Ts> struct op_maybe<T, Ts...> {
         return ptr;
     }
 };
+template <typename ...Ts> struct op_maybe_impl<true, Ts...> {
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        if (ptr < ptr_end) {
+            const char* ptr_next = first_table<alternatives<0, Ts...>>::parse(ptr, ptr_end, ctx);
+            return ptr_next ? ptr_next : ptr;
+        }
+        return ptr;
+    }
+};
 
 // terms
 
+// handlers return void or, when they may reject the value, bool (see validate.hpp);
+// for the void ones the check folds away
+template <typename Result> struct handler_result {
+    template <typename Handler, typename ...Args> static inline bool call(Args&&... args) {
+        Handler::handle(std::forward<Args>(args)...);
+        return true;
+    }
+};
+template <> struct handler_result<bool> {
+    template <typename Handler, typename ...Args> static inline bool call(Args&&... args) {
+        return Handler::handle(std::forward<Args>(args)...);
+    }
+};
+template <typename Handler, typename ...Args> static inline bool invoke_handler(Args&&... args) {
+    using result = decltype(Handler::handle(std::forward<Args>(args)...));
+    return handler_result<result>::template call<Handler>(std::forward<Args>(args)...);
+}
+
 template <char T, typename Handler = void>
 struct term_char {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return c == static_cast<unsigned char>(T); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         if (ptr - ptr_end == 0) return NULL;
         if (*ptr == T) {
-            Handler::handle(T, ctx);
+            if (!invoke_handler<Handler>(T, ctx)) return NULL;
             return ptr + 1;
         }
         return NULL;
@@ -246,7 +454,10 @@ struct term_char {
 
 template <char T>
 struct term_char<T, void> {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t&) {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return c == static_cast<unsigned char>(T); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context&) {
         if (ptr - ptr_end == 0) return NULL;
         if (*ptr == T) return ptr + 1;
         return NULL;
@@ -255,7 +466,10 @@ struct term_char<T, void> {
 
 template <int N, typename Handler>
 struct term_number {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return c >= '0' && c <= '9'; }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         const char* number_end = ptr + N;
         if (number_end > ptr_end) return NULL;
         int value = 0;
@@ -267,7 +481,7 @@ struct term_number {
                 return NULL;
             }
         }
-        Handler::handle(value, ctx);
+        if (!invoke_handler<Handler>(value, ctx)) return NULL;
         return number_end;
     }
 };
@@ -275,7 +489,10 @@ struct term_number {
 // parses [1...N] digits
 template <int N, typename Handler>
 struct term_var_number {
-    static inline const char* parse(const char* ptr, const char* ptr_end, context_t& ctx) {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return c >= '0' && c <= '9'; }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
         const char* number_end = std::min(ptr + N, ptr_end);
         if (ptr >= ptr_end) return NULL;
         int value = 0;
@@ -291,7 +508,7 @@ struct term_var_number {
         }
         if (ptr == start) return NULL;
         auto count = ptr - start;
-        Handler::handle(value, count, ctx);
+        if (!invoke_handler<Handler>(value, static_cast<int>(count), ctx)) return NULL;
         return ptr;
     }
 };
@@ -314,7 +531,7 @@ using term_sec_v        = term_var_number<2, handler_second_v>;
 using term_tz_UTC       = term_char<'Z', handler_tz_utc>;
 using term_hour_tz      = term_number<2, handler_tz_offset_hour>;
 using term_min_tz       = term_number<2, handler_tz_offset_minute>;
-using term_fraction_p   = term_var_number<6, handler_fraction>;
+using term_fraction_p   = term_var_number<9, handler_fraction>;
 using term_fraction     = op_seq<op_or<term_char<'.'>, term_char<','>>, term_fraction_p>;
 template<char T> using term_tz_sing = term_char<T, handler_tz_offset_sign>;
 template<char T> using term_year_sign = term_char<T, handler_year_sign>;
@@ -322,18 +539,25 @@ template<typename B> using term_fraq = op_seq<B, term_fraction>;
 
 
 
+// the alternatives starting with a digit are grouped, so that the byte after
+// the year (and after the '-') selects the branch; within a group they are
+// tried in order, the others would have failed on that byte
 using grammar_date = op_seq<
     term_year,                                                                                                      // YYYY
     op_maybe<
         op_or<
-            op_seq<term_month, term_day>,                                                                           // YYYYMMDD,
+            op_or<
+                op_seq<term_month, term_day>,                                                                       // YYYYMMDD,
+                term_ordinal_date                                                                                   // YYYYDDD
+            >,
             op_seq<term_char<'-'>, op_or<
-                term_ordinal_date,                                                                                  // YYYY-DDD
-                op_seq<term_month, op_maybe<op_seq<term_char<'-'>, term_day>>>,                                     // YYYY-MM, YYYY-MM-DD
+                op_or<
+                    term_ordinal_date,                                                                              // YYYY-DDD
+                    op_seq<term_month, op_maybe<op_seq<term_char<'-'>, term_day>>>                                  // YYYY-MM, YYYY-MM-DD
+                >,
                 op_seq<term_char<'W'>, term_week, op_maybe<op_seq<term_char<'-'>, term_week_day>>>
             >>,
-            op_seq<term_char<'W'>, term_week, op_maybe< term_week_day>>,                                            // YYYYWww, YYYYWwwD
-            term_ordinal_date                                                                                       // YYYYDDD
+            op_seq<term_char<'W'>, term_week, op_maybe< term_week_day>>                                             // YYYYWww, YYYYWwwD
         >
     >
 >;
@@ -352,14 +576,14 @@ using grammar_time = op_seq<
         op_or<
             op_seq<term_min, op_maybe<                                          // HHMM
                 term_sec,                                                       // HHMMSS
-                op_maybe<term_fraction>                                         // HHMM.M{1,6}
+                op_maybe<term_fraction>                                         // HHMM.M{1,9}
             >>,
             op_seq<term_char<':'>, term_min,                                    // HH:MM
                 op_maybe<
-                    op_seq<term_char<':'>, term_sec, op_maybe<term_fraction>>,  // HH:MM:SS, HH:MM:SS.S{1,6}
-                    term_fraction                                               // HH:MM.M{1,6}
+                    op_seq<term_char<':'>, term_sec, op_maybe<term_fraction>>,  // HH:MM:SS, HH:MM:SS.S{1,9}
+                    term_fraction                                               // HH:MM.M{1,9}
             >>,
-            term_fraction                                                       // HH.H{1,6}
+            term_fraction                                                       // HH.H{1,9}
         >
     >
 >;
@@ -410,7 +634,7 @@ using grammar_generic = op_seq<
                 term_char<':'>,
                 term_sec_v,                                             // HH:MM:SS
                 op_maybe<op_seq<
-                    term_fraction,                                      // .s{1,6}
+                    term_fraction,                                      // .s{1,9}
                     op_maybe<op_seq<
                         op_or<term_tz_sing<'+'>, term_tz_sing<'-'>>,    // ±HH:MM, ±HHMM, ±HH
                         grammar_tz_offset
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstring>
+#include "iso8601.hpp"
+#include "epoch.hpp"
+#include "validate.hpp"
+#include "flat.hpp"
+#include "formatter.hpp"
+
+// Fixed sets of names (months, weekdays, zones) as single terms: the Width
+// bytes at ptr are packed into one integer, lowercased, and looked up in a
+// 32-slot table through a multiplicative perfect hash found at compile time,
+// then compared once. A set is a struct with
+//
+//   static constexpr int width = 3;
+//   static constexpr const char* words[] = {"jan", ...};     // lowercase
+//   static constexpr int values[] = {1, ...};                 // passed to the handler
+//
+// The names are matched case-insensitively, the formatting tags write them in
+// the usual capitalization. In flat<G> and stream<G> a keyword is one KEYWORD
+// instruction: the engine packs the bytes, the action does the lookup.
+
+namespace parser {
+
+template <typename Set>
+struct keyword_table {
+    static constexpr int width = Set::width;
+    static constexpr std::size_t count = sizeof(Set::values) / sizeof(Set::values[0]);
+    static constexpr int bits = 5;
+    static_assert(width >= 1 && width <= 4, "keywords are packed into 32 bits");
+    static_assert(count <= (1u << bits), "too many keywords for the table");
+
+    struct table_t {
+        uint32_t multiplier;
+        uint32_t keys[1 << bits];                       // 0 for the empty slots, no key packs to 0
+        int values[1 << bits];
+    };
+
+    template <typename Byte>
+    static constexpr uint32_t pack(const Byte* ptr) {
+        uint32_t key = 0;
+        for (int i = 0; i < width; ++i) key = key << 8 | (static_cast<uint8_t>(ptr[i]) | 0x20);
+        return key;
+    }
+
+    static constexpr uint32_t slot(uint32_t key, uint32_t multiplier) {
+        return static_cast<uint32_t>(key * multiplier) >> (32 - bits);
+    }
+
+    static constexpr table_t build() {
+        for (uint32_t multiplier = 0x9E3779B1u; multiplier != 0x9E3779B1u + 2 * 4096; multiplier += 2) {
+            table_t table {multiplier, {}, {}};
+            bool perfect = true;
+            for (std::size_t i = 0; i < count && perfect; ++i) {
+                const uint32_t key = pack(Set::words[i]);
+                const uint32_t s = slot(key, multiplier);
+                perfect = table.keys[s] == 0;
+                table.keys[s] = key;
+                table.values[s] = Set::values[i];
+            }
+            if (perfect) return table;
+        }
+        return table_t {0, {}, {}};
+    }
+
+    static constexpr bool first(unsigned c) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if ((c | 0x20) == static_cast<unsigned char>(Set::words[i][0])) return true;
+        }
+        return false;
+    }
+};
+
+template <typename Set> struct keyword_slots {
+    static constexpr typename keyword_table<Set>::table_t value = keyword_table<Set>::build();
+    static_assert(value.multiplier != 0, "no perfect hash multiplier found for the keyword set");
+};
+
+template <typename Set, typename Handler>
+struct term_keyword {
+    using table = keyword_table<Set>;
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return table::first(c); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        if (ptr_end - ptr < table::width) return NULL;
+        return match(table::pack(ptr), ctx) ? ptr + table::width : NULL;
+    }
+
+    // a packed key: the handler is called with its value, false when the key
+    // is not in the set or the handler rejects the value
+    template <typename Context>
+    static inline bool match(uint32_t key, Context& ctx) {
+        const auto& slots = keyword_slots<Set>::value;
+        const uint32_t s = table::slot(key, slots.multiplier);
+        return slots.keys[s] == key && invoke_handler<Handler>(slots.values[s], ctx);
+    }
+};
+
+template <typename Set, typename Handler, typename Context> struct keyword_action {
+    static bool match(int key, int, Context& ctx) { return term_keyword<Set, Handler>::match(static_cast<uint32_t>(key), ctx); }
+};
+
+template <typename Set, typename Handler, typename Context> struct lower<term_keyword<Set, Handler>, Context> {
+    static constexpr std::size_t size() { return 1; }
+    static constexpr std::size_t depth() { return 0; }
+    static constexpr instruction_t<Context> at(std::size_t) {
+        return instruction_t<Context>{opcode_t::KEYWORD, Set::width, 0, &keyword_action<Set, Handler, Context>::match};
+    }
+};
+
+template <typename Set, typename Handler> struct validate<term_keyword<Set, Handler>> {
+    using type = term_keyword<Set, checked<Handler>>;
+};
+
+struct month_names {
+    static constexpr int width = 3;
+    static constexpr const char* words[] = {"jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"};
+    static constexpr int values[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+};
+
+// ISO numbering, Monday = 1
+struct week_day_names {
+    static constexpr int width = 3;
+    static constexpr const char* words[] = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+    static constexpr int values[] = {1, 2, 3, 4, 5, 6, 7};
+};
+
+// the 3 letters zones of RFC 2822, minutes east of UTC; "UT" and the military
+// letters are left out
+struct zone_names {
+    static constexpr int width = 3;
+    static constexpr const char* words[] = {"gmt", "utc", "est", "edt", "cst", "cdt", "mst", "mdt", "pst", "pdt"};
+    static constexpr int values[] = {0, 0, -300, -240, -360, -300, -420, -360, -480, -420};
+};
+
+struct gmt_name {
+    static constexpr int width = 3;
+    static constexpr const char* words[] = {"gmt"};
+    static constexpr int values[] = {0};
+};
+
+struct handler_tz_name {
+    template <typename Context>
+    static inline void handle(int value, Context& ctx) {
+        ctx.tz.tz_info = tz_info_t::UTC;
+        ctx.tz.sign = value < 0 ? -1 : 1;
+        ctx.tz.hour = (value < 0 ? -value : value) / 60;
+        ctx.tz.minute = (value < 0 ? -value : value) % 60;
+    }
+};
+
+using term_month_name    = term_keyword<month_names, handler_month>;
+using term_week_day_name = term_keyword<week_day_names, handler_week_day>;
+using term_zone_name     = term_keyword<zone_names, handler_tz_name>;
+using term_gmt           = term_keyword<gmt_name, handler_tz_utc>;
+using term_day_v         = term_var_number<2, handler_day_v>;
+
+using grammar_rfc2822 = op_seq<
+    op_maybe<op_seq<term_week_day_name, term_char<','>, term_char<' '>>>,                  // [Tue, ]
+    term_day_v, term_char<' '>, term_month_name, term_char<' '>, term_year, term_char<' '>,  // 15 Nov 1994
+    term_hour, term_char<':'>, term_min, op_maybe<op_seq<term_char<':'>, term_sec>>,        // 08:12[:31]
+    term_char<' '>,
+    op_or<
+        term_zone_name,                                                                    // GMT, EST, ...
+        op_seq<op_or<term_tz_sing<'+'>, term_tz_sing<'-'>>, term_hour_tz, term_min_tz>     // ±HHMM
+    >
+>;
+
+// IMF-fixdate of RFC 7231, the one HTTP servers must send: Tue, 15 Nov 1994 08:12:31 GMT
+using grammar_http_date = op_seq<
+    term_week_day_name, term_char<','>, term_char<' '>,
+    term_day, term_char<' '>, term_month_name, term_char<' '>, term_year, term_char<' '>,
+    term_hour, term_char<':'>, term_min, term_char<':'>, term_sec, term_char<' '>,
+    term_gmt
+>;
+
+// RFC 3164: Oct 11 22:14:15, the day padded with a space; there is no year,
+// the context keeps the one it was given
+using grammar_syslog = op_seq<
+    term_month_name, term_char<' '>,
+    op_or<op_seq<term_char<' '>, term_number<1, handler_day>>, term_day>,
+    term_char<' '>, term_hour, term_char<':'>, term_min, term_char<':'>, term_sec
+>;
+
+}
+
+// formatting, out of range fields give "???"
+struct keyword_names {
+    static inline const char* months() { return "JanFebMarAprMayJunJulAugSepOctNovDec"; }
+    static inline const char* week_days() { return "MonTueWedThuFriSatSun"; }
+};
+
+struct tag_month_name : tag_t<3> {
+    inline static bool fits(const datetime& dt) { return dt.mon >= 1 && dt.mon <= 12; }
+    inline static bool changed(const datetime& a, const datetime& b) { return a.mon != b.mon; }
+    inline static void patch(char* in, const datetime& dt) { std::memcpy(in, keyword_names::months() + (dt.mon - 1) * 3, 3); }
+    inline static char* apply(char* in, datetime& dt) {
+        std::memcpy(in, fits(dt) ? keyword_names::months() + (dt.mon - 1) * 3 : "???", 3);
+        return in + 3;
+    }
+};
+
+// computed from the date, a parsed weekday name is not kept anywhere
+struct tag_week_day_name : tag_t<3> {
+    inline static bool fits(const datetime& dt) { return dt.mon >= 1 && dt.mon <= 12; }
+    inline static bool changed(const datetime& a, const datetime& b) {
+        return a.year != b.year || a.mon != b.mon || a.mday != b.mday;
+    }
+    inline static void patch(char* in, const datetime& dt) {
+        const uint32_t week_day = parser::civil::week_day(parser::civil::days_from_civil(dt.year, dt.mon, dt.mday));
+        std::memcpy(in, keyword_names::week_days() + (week_day - 1) * 3, 3);
+    }
+    inline static char* apply(char* in, datetime& dt) {
+        if (fits(dt)) patch(in, dt);
+        else std::memcpy(in, "???", 3);
+        return in + 3;
+    }
+};
+
+// day of month padded with a space, " 1" .. "31"
+struct tag_day_padded : tag_t<2> {
+    using pattern = chars<' ', '0'>;
+    inline static bool changed(const datetime& a, const datetime& b) { return a.mday != b.mday; }
+    inline static void patch(char* in, const datetime& dt) {
+        apply2(in, dt.mday);
+        if (in[0] == '0') in[0] = ' ';
+    }
+    inline static char* apply(char* in, datetime& dt) {
+        patch(in, dt);
+        return in + 2;
+    }
+};
+
+using http_date_t = expression_t<
+    tag_week_day_name, tag_char<','>, tag_char<' '>, tag_day, tag_char<' '>, tag_month_name, tag_char<' '>, tag_year, tag_char<' '>,
+    tag_hour, tag_char<':'>, tag_min, tag_char<':'>, tag_sec, tag_char<' '>, tag_char<'G'>, tag_char<'M'>, tag_char<'T'>
+>;
+
+using rfc2822_t = expression_t<
+    tag_week_day_name, tag_char<','>, tag_char<' '>, tag_day, tag_char<' '>, tag_month_name, tag_char<' '>, tag_year, tag_char<' '>,
+    tag_hour, tag_char<':'>, tag_min, tag_char<':'>, tag_sec, tag_char<' '>, tag_char<'+'>, tag_char<'0'>, tag_char<'0'>, tag_char<'0'>, tag_char<'0'>
+>;
+
+using syslog_t = expression_t<
+    tag_month_name, tag_char<' '>, tag_day_padded, tag_char<' '>, tag_hour, tag_char<':'>, tag_min, tag_char<':'>, tag_sec
+>;
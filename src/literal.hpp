@@ -0,0 +1,80 @@
+#pragma once
+
+#include <type_traits>
+#include "iso8601.hpp"
+#include "formatter.hpp"
+#include "keyword.hpp"
+
+// A format literal turned into both the formatter and the matching grammar at
+// compile time, so that the two can not drift apart:
+//
+//   constexpr char iso_format[] = "%Y-%m-%d %H:%M:%S";
+//   format_literal<iso_format>::expression      // == iso_t
+//   format_literal<iso_format>::grammar         // op_seq<term_year, term_char<'-'>, ...>
+//
+//   %Y year (4 digits)  %m month  %d day  %H hour  %M minute  %S second
+//   %b month name  %a weekday name (see keyword.hpp)
+//   %F = %Y-%m-%d  %T = %H:%M:%S  %% = %
+//
+// The literal must have static storage, any other conversion fails to compile.
+
+template <typename ...Ts> struct type_list {};
+
+template <typename ...Ts> struct join;
+template <> struct join<> { using type = type_list<>; };
+template <typename ...As> struct join<type_list<As...>> { using type = type_list<As...>; };
+template <typename ...As, typename ...Bs, typename ...Ts> struct join<type_list<As...>, type_list<Bs...>, Ts...> {
+    using type = typename join<type_list<As..., Bs...>, Ts...>::type;
+};
+
+template <template <typename...> class T, typename L> struct apply_list;
+template <template <typename...> class T, typename ...Ts> struct apply_list<T, type_list<Ts...>> { using type = T<Ts...>; };
+
+// the tags and the terms of one conversion
+template <char C> struct conversion {
+    static_assert(C != C, "unsupported conversion in a format literal");
+};
+template <typename Tag, typename Term> struct conversion_of {
+    using tags = type_list<Tag>;
+    using terms = type_list<Term>;
+};
+template <> struct conversion<'Y'>: conversion_of<tag_year, parser::term_year> {};
+template <> struct conversion<'m'>: conversion_of<tag_month, parser::term_month> {};
+template <> struct conversion<'d'>: conversion_of<tag_day, parser::term_day> {};
+template <> struct conversion<'H'>: conversion_of<tag_hour, parser::term_hour> {};
+template <> struct conversion<'M'>: conversion_of<tag_min, parser::term_min> {};
+template <> struct conversion<'S'>: conversion_of<tag_sec, parser::term_sec> {};
+template <> struct conversion<'b'>: conversion_of<tag_month_name, parser::term_month_name> {};
+template <> struct conversion<'a'>: conversion_of<tag_week_day_name, parser::term_week_day_name> {};
+template <> struct conversion<'%'>: conversion_of<tag_char<'%'>, parser::term_char<'%'>> {};
+template <> struct conversion<'F'> {
+    using tags = type_list<tag_year, tag_char<'-'>, tag_month, tag_char<'-'>, tag_day>;
+    using terms = type_list<parser::term_year, parser::term_char<'-'>, parser::term_month, parser::term_char<'-'>, parser::term_day>;
+};
+template <> struct conversion<'T'> {
+    using tags = type_list<tag_hour, tag_char<':'>, tag_min, tag_char<':'>, tag_sec>;
+    using terms = type_list<parser::term_hour, parser::term_char<':'>, parser::term_min, parser::term_char<':'>, parser::term_sec>;
+};
+
+// walks the literal from I on, one conversion or plain char at a time
+template <const char* Format, std::size_t I = 0, char C = Format[I]> struct format_scan {
+    using rest = format_scan<Format, I + 1>;
+    using tags = typename join<type_list<tag_char<C>>, typename rest::tags>::type;
+    using terms = typename join<type_list<parser::term_char<C>>, typename rest::terms>::type;
+};
+template <const char* Format, std::size_t I> struct format_scan<Format, I, '%'> {
+    using head = conversion<Format[I + 1]>;
+    using rest = format_scan<Format, I + 2>;
+    using tags = typename join<typename head::tags, typename rest::tags>::type;
+    using terms = typename join<typename head::terms, typename rest::terms>::type;
+};
+template <const char* Format, std::size_t I> struct format_scan<Format, I, '\0'> {
+    using tags = type_list<>;
+    using terms = type_list<>;
+};
+
+template <const char* Format>
+struct format_literal {
+    using expression = typename apply_list<expression_t, typename format_scan<Format>::tags>::type;
+    using grammar = typename apply_list<parser::op_seq, typename format_scan<Format>::terms>::type;
+};
@@ -1,118 +1,103 @@
-#include <type_traits>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <vector>
 #include "iso8601.hpp"
+#include "formatter.hpp"
+#include "batch.hpp"
+#include "fast_path.hpp"
+#include "flat.hpp"
+#include "epoch.hpp"
+#include "stream.hpp"
+#include "validate.hpp"
+#include "pattern.hpp"
+#include "literal.hpp"
+#include "zone.hpp"
+#include "view.hpp"
+#include "format_batch.hpp"
+#include "trace.hpp"
+#include "keyword.hpp"
+#include "memo.hpp"
+#include "detect.hpp"
+#include "column.hpp"
 
-char* itoa (int64_t i) {
-    const int INT_DIGITS = 19; /* enough for 64 bit integer */
-    static char buf[INT_DIGITS + 2]; /* Room for INT_DIGITS digits, - and '\0' */
-    char *p = buf + INT_DIGITS + 1;   /* points to terminating '\0' */
-    if (i >= 0) {
-        do {
-            *--p = '0' + (i % 10);
-            i /= 10;
-        } while (i != 0);
-        return p;
-    }
-    else {            /* i < 0 */
-        do {
-            *--p = '0' - (i % 10);
-            i /= 10;
-        } while (i != 0);
-        *--p = '-';
-    }
-    return p;
-}
-
-template <std::size_t N>
-struct tag_t: std::integral_constant<std::size_t, N>{
-    inline static char* apply2(char* in, int value) {
-        size_t i;
-        auto* buff = itoa(value);
-        auto len = strlen(buff);
-        for (i = 0; i < 2 - len; i++) *(in++) = '0';
-        for (i = 0; i < len; i++) *(in++) = *(buff++);
-        return in;
-    }
-};
-
-struct tag_year     : tag_t<4> {
-    inline static char* apply(char* in, datetime& dt) {
-        size_t i;
-        auto* buff = itoa(dt.year);
-        auto* orig_ptr = in;
-        auto len = strlen(buff );
-        if (dt.year >= 0 && dt.year <= 999) {
-            for (i = 0; i < 4 - len; i++) *(in++) = '0';
-        }
-        for (i = 0; i < len; i++) *(orig_ptr++) = *(buff++);
-        return orig_ptr;
-    }
-};
-struct tag_month    : tag_t<2> { inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.mon); }};
-struct tag_day      : tag_t<2> { inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.mday); }};
-struct tag_hour     : tag_t<2> { inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.hour); }};
-struct tag_min      : tag_t<2> { inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.min); }};
-struct tag_sec      : tag_t<2> { inline static char* apply(char* in, datetime& dt) { return apply2(in, dt.sec); }};
-struct tag_ampm     : tag_t<2> { inline static char* apply(char* in, datetime& dt) {
-    *(in++) = dt.hour < 12 ? 'A' : 'P';
-    *(in++) = 'M';
-    return in;
-}};
+constexpr char iso_format[] = "%Y-%m-%d %H:%M:%S";
+constexpr char log_format[] = "[%F %T]";
+constexpr char compact_format[] = "%Y%m%dT%H%M%S";
+static_assert(std::is_same<format_literal<iso_format>::expression, iso_t>::value,
+              "a format literal gives the same type as the hand written expression");
+constexpr char http_format[] = "%a, %d %b %Y %T GMT";
+static_assert(std::is_same<format_literal<http_format>::expression, http_date_t>::value,
+              "the names convert as the hand written tags");
 
-template <char C>
-struct tag_char : tag_t<1> {
-    inline static char* apply(char* in, datetime& dt) {
-        *in = C;
-        return ++in;
-    }
-};
+template <typename E>
+void format(datetime dt) {
+    char buff[E::N + 16] = {0};
+    char* buff_end = E::apply(buff, dt);
+    auto sz = buff_end - buff;
+    *buff_end = 0;
+    std::cout << "result " << sz << "/" << E::N << " bytes :: " << buff << "\n";
+}
 
+template <typename F>
+void format(F& formatter, datetime dt) {
+    char buff[F::N + 16] = {0};
+    char* buff_end = formatter.apply(buff, dt);
+    *buff_end = 0;
+    std::cout << "cached result " << (buff_end - buff) << "/" << F::N << " bytes :: " << buff << "\n";
+}
 
-template <typename ...Ts> struct size_of_t;
-template <typename T> struct size_of_t<T> { static const auto Value = T::value; };
-template <typename T, typename ...Ts> struct size_of_t<T, Ts ...> {
-    static const auto Value = (size_of_t<T>::Value + size_of_t<Ts...>::Value);
-};
+// the cached formatter against a fresh render of the same value
+template <typename E>
+void format_cached(cached_expression_t<E>& cached, datetime dt) {
+    char fresh[E::N + 16] = {0}, reused[E::N + 16] = {0};
+    datetime copy = dt;
+    E::apply(fresh, copy);
+    cached.apply(reused, dt);
+    std::cout << (!memcmp(fresh, reused, E::N) ? "ok " : "[!] ") << "cached result " << E::N << " bytes :: " << reused << "\n";
+}
 
-template <typename ... Tags> struct Composer;
-template <typename T1> struct Composer<T1> {
-    static char* fn(char* in, datetime& dt) {
-        return T1::apply(in, dt);
-    }
-};
-template <typename T, typename ...Tags> struct Composer<T, Tags...> {
-    static char* fn(char* in, datetime& dt) {
-        return Composer<Tags...>::fn(Composer<T>::fn(in, dt), dt);
+void format_pattern(const char* pattern, datetime dt, parser::microsec_t mksec, parser::timezone_t tz, const char* expected = NULL) {
+    pattern_t p;
+    if (!p.compile(pattern)) {
+        std::cout << "pattern '" << pattern << "' rejected\n";
+        return;
     }
-    static char* compose(char* in, datetime& dt) {
-        return fn(in, dt);
-    }
-};
-
-template <typename ...Args>
-struct expression_t {
-    static const auto N  = size_of_t<Args...>::Value;
-    using FinalComposer = Composer<Args...>;
+    char buff[pattern_t::max_size + 16] = {0};
+    char* buff_end = p.format(buff, dt, mksec, tz);
+    *buff_end = 0;
+    if (expected) std::cout << (!strcmp(buff, expected) ? "ok " : "[!] ");
+    std::cout << "pattern '" << pattern << "' result " << (buff_end - buff) << "/" << p.size() << " bytes :: " << buff << "\n";
+}
 
-    inline static char* apply(char* in, datetime& dt) {
-        return FinalComposer::compose(in,dt);
+// every row of the batch against E::apply of the same value, through the
+// dispatched kernel and the scalar rows
+template <typename E>
+void format_batch(const std::vector<datetime>& values, std::size_t expected, char delim) {
+    const std::size_t stride = batch_expression_t<E>::stride;
+    std::vector<char> fast(values.size() * stride), slow(values.size() * stride);
+    const std::size_t count = batch_expression_t<E>::apply(values.data(), values.size(), fast.data(), delim);
+    const std::size_t scalar = batch_rows<E>::apply(values.data(), values.size(), slow.data(), delim);
+    std::size_t same = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        char buff[64];
+        datetime dt = values[i];
+        *E::apply(buff, dt) = delim;
+        same += !memcmp(buff, &fast[i * stride], stride) && !memcmp(buff, &slow[i * stride], stride);
     }
-};
-
-using iso_t = expression_t<
-    tag_year, tag_char<'-'>, tag_month, tag_char<'-'>, tag_day, tag_char<' '>,
-    tag_hour, tag_char<':'>, tag_min, tag_char<':'>, tag_sec
->;
-
+    std::cout << (count == expected && scalar == expected && same == count ? "ok " : "[!] ")
+        << "batch format of " << values.size() << " values, " << count << " rows";
+    if (count) std::cout << " :: " << std::string(&fast[0], stride - 1) << " .. " << std::string(&fast[(count - 1) * stride], stride - 1);
+    std::cout << "\n";
+}
 
 template <typename G>
 void parse(const char* sample, bool expected) {
     datetime dt {0, 0, 0, 0, 0, 0};
     parser::microsec_t mksec {0};
+    parser::nanosec_t nsec {0};
     parser::timezone_t tz { parser::tz_info_t::LOCAL, 1, 0, 0 };
-    parser::context_t ctx {dt, mksec, tz, 0, 0, 0, parser::time_unit_t::NONE };
+    parser::context_t ctx {dt, mksec, tz, 1, 0, 0, parser::time_unit_t::NONE, &nsec };
     const char* end = sample + strlen(sample);
     const char* result = G::parse(sample, end, ctx);
     bool r = (result == end);
@@ -129,7 +114,7 @@ void parse(const char* sample, bool expected) {
             << "y = " << dt.year << ", m = " << dt.mon << ", d = " << dt.mday
             << ", c.week = " << ctx.week << ", c.week_day= " << ctx.week_day
             << ", h = " << dt.hour << ", min = " << dt.min << ", sec = " << dt.sec
-            << ", mksec = " << mksec;
+            << ", mksec = " << mksec << ", nsec = " << nsec;
         if (utc) {
             std::cout << ", UTC offset: " << (tz.sign > 0 ? '+' : '-')
                 << tz.hour << ":" << tz.minute;
@@ -141,13 +126,331 @@ void parse(const char* sample, bool expected) {
 }
 
 
+template <typename G>
+void parse_epoch(const char* sample, parser::epoch_t expected) {
+    parser::epoch_t value = 0;
+    const char* end = sample + strlen(sample);
+    bool r = parser::epoch<G>::parse(sample, end, value) == end;
+    std::cout << (r && value == expected ? "ok " : "[!] ") << "sample '" << sample << "' ";
+    if (r) {
+        std::cout << "epoch = " << value << " us\n";
+    } else {
+        std::cout << "failed to parse\n";
+    }
+}
+
+// a year out of the epoch_t range: rejected by epoch<G> and column<G>
+template <typename G>
+void parse_epoch_out_of_range(const char* sample) {
+    parser::epoch_t value = 0;
+    parser::column_t column;
+    const char* end = sample + strlen(sample);
+    const bool r = parser::epoch<G>::parse(sample, end, value) || parser::column<G>::parse(sample, end, column)
+        || parser::column<G>::parse(sample, end, '\n', column);
+    std::cout << (r ? "[!] " : "ok ") << "sample '" << sample << "' out of the epoch range\n";
+}
+
+// two samples through one context: the nsec of the second is its own
+template <typename G>
+void parse_nsec_reused(const char* first, const char* second, parser::nanosec_t expected) {
+    datetime dt {0, 0, 0, 0, 0, 0};
+    parser::microsec_t mksec {0};
+    parser::timezone_t tz { parser::tz_info_t::LOCAL, 1, 0, 0 };
+    parser::nanosec_t nsec {0};
+    parser::context_t ctx {dt, mksec, tz, 1, 0, 0, parser::time_unit_t::NONE, &nsec };
+    const bool r = G::parse(first, first + strlen(first), ctx) && G::parse(second, second + strlen(second), ctx);
+    std::cout << (r && nsec == expected ? "ok " : "[!] ") << "sample '" << second << "' after '" << first << "', nsec = " << nsec << "\n";
+}
+
+// the sample cut in two at every position must give what parsing it whole gives
+template <typename G>
+void parse_stream(const char* sample) {
+    using stream = parser::stream<G>;
+    const std::size_t size = strlen(sample);
+    parser::epoch_t expected = 0;
+    const bool whole = parser::epoch<G>::parse(sample, sample + size, expected) == sample + size;
+    std::size_t mismatches = 0;
+    for (std::size_t split = 0; split <= size; ++split) {
+        datetime dt {0, 0, 0, 0, 0, 0};
+        parser::microsec_t mksec {0};
+        parser::timezone_t tz { parser::tz_info_t::LOCAL, 1, 0, 0 };
+        parser::context_t ctx {dt, mksec, tz, 1, 0, 0, parser::time_unit_t::NONE, nullptr };
+        typename stream::state_t state {};
+        const char* ptr = sample;
+        auto status = stream::feed(state, ptr, sample + split, ctx);
+        if (status == parser::stream_status_t::MORE) {
+            status = stream::feed(state, ptr, sample + size, ctx);
+        }
+        if (status == parser::stream_status_t::MORE) status = stream::finish(state, ctx);
+        const bool r = status == parser::stream_status_t::DONE && state.pos == size;
+        mismatches += r != whole || (r && parser::civil::to_epoch(ctx) != expected);
+    }
+    std::cout << (mismatches ? "[!] " : "ok ") << "sample '" << sample << "' streamed in 2 chunks at "
+        << (size + 1) << " split points, " << mismatches << " mismatches\n";
+}
+
+// one grammar into the three context types, the epochs must agree
+template <typename G>
+void parse_contexts(const char* sample) {
+    const char* end = sample + strlen(sample);
+    datetime dt {0, 0, 0, 0, 0, 0};
+    parser::microsec_t mksec {0};
+    parser::timezone_t tz { parser::tz_info_t::LOCAL, 1, 0, 0 };
+    parser::context_t ctx {dt, mksec, tz, 1, 0, 0, parser::time_unit_t::NONE, nullptr };
+    parser::value_context_t value {};
+    value.year_sign = 1;
+    parser::packed_context_t packed {};
+    packed.year_sign = 1;
+    const bool r = G::parse(sample, end, ctx) == end && G::parse(sample, end, value) == end
+        && G::parse(sample, end, packed) == end;
+    const parser::epoch_t epoch = parser::civil::to_epoch(ctx);
+    const bool same = r && parser::civil::to_epoch(value) == epoch && parser::civil::to_epoch(packed) == epoch;
+    std::cout << (same ? "ok " : "[!] ") << "sample '" << sample << "' parsed into context_t, value_context_t and "
+        << "packed_context_t (" << sizeof(packed) << " bytes), epoch = " << epoch << " us\n";
+}
+
+// parses the sample with the pattern, then renders it back with the same pattern
+void parse_pattern(const char* pattern, const char* sample, bool expected, const char* rendered = NULL) {
+    pattern_t p;
+    p.compile(pattern);
+    parser::value_context_t ctx {};
+    ctx.year_sign = 1;
+    const char* end = sample + strlen(sample);
+    const bool r = p.parse(sample, end, ctx) == end;
+    std::cout << (r == expected ? "ok " : "[!] ") << "pattern '" << pattern << "' ";
+    if (!r) {
+        std::cout << "failed to parse '" << sample << "'\n";
+        return;
+    }
+    char buff[pattern_t::max_size + 16] = {0};
+    *p.format(buff, ctx.dt, ctx.mksec, ctx.tz) = 0;
+    if (rendered && strcmp(buff, rendered)) std::cout << "[!] ";
+    std::cout << "sample '" << sample << "' parsed, rendered back as '" << buff << "'\n";
+}
+
+// a LOCAL sample taken in the zone, then the epoch rendered back on its wall clock
+void parse_zone(const parser::zone_t& zone, const char* name, const char* sample, parser::epoch_t expected) {
+    parser::value_context_t ctx {};
+    ctx.year_sign = 1;
+    const char* end = sample + strlen(sample);
+    const bool r = parser::grammar_generic::parse(sample, end, ctx) == end;
+    const parser::epoch_t value = r ? zone.to_epoch(ctx) : 0;
+    std::cout << (r && value == expected ? "ok " : "[!] ") << "sample '" << sample << "' in " << name
+        << ", epoch = " << value << " us";
+    datetime dt;
+    parser::microsec_t mksec;
+    parser::timezone_t tz;
+    zone.to_local(value, dt, mksec, tz);
+    char buff[iso_t::N + 16] = {0};
+    *iso_t::apply(buff, dt) = 0;
+    std::cout << ", back as '" << buff << (tz.sign < 0 ? '-' : '+') << tz.hour << ":" << tz.minute << "'\n";
+}
+
+// the view must read back what G stores and compare like the epochs
+template <typename G>
+void parse_view(const char* sample, const char* other) {
+    parser::view_t a, b;
+    const bool r = parser::view<G>::parse(sample, sample + strlen(sample), a) && parser::view<G>::parse(other, other + strlen(other), b);
+    parser::epoch_t x = 0, y = 0;
+    parser::epoch<G>::parse(sample, sample + strlen(sample), x);
+    parser::epoch<G>::parse(other, other + strlen(other), y);
+    const int order = parser::view_t::compare(a, b);
+    const bool same = r && a.epoch() == x && b.epoch() == y && (order > 0) - (order < 0) == (x > y) - (x < y);
+    std::cout << (same ? "ok " : "[!] ") << "sample '" << sample << "' viewed. y = " << a.year() << ", m = " << a.month()
+        << ", d = " << a.day() << ", h = " << a.hour() << ", min = " << a.minute() << ", sec = " << a.second()
+        << (a.layout ? ", canonical" : "") << "; vs '" << other << "': " << (order < 0 ? "<" : order > 0 ? ">" : "==")
+        << (a.layout && a.layout == b.layout ? " as bytes" : " as epochs") << "\n";
+}
+
+// the traced grammar must return and store what G does, then the counters
+template <typename G>
+void parse_traced(std::initializer_list<const char*> samples) {
+    using T = parser::traced<G, parser::trace_on>;
+    parser::trace_of<T>::reset();
+    std::size_t same = 0;
+    for (const char* sample : samples) {
+        const char* end = sample + strlen(sample);
+        parser::value_context_t a = parser::value_context_t::local();
+        parser::value_context_t b = a;
+        same += G::parse(sample, end, a) == T::parse(sample, end, b) && !memcmp(&a.dt, &b.dt, sizeof(datetime))
+            && a.mksec == b.mksec && a.week == b.week && a.week_day == b.week_day;
+    }
+    std::cout << (same == samples.size() ? "ok " : "[!] ") << "traced grammar over " << samples.size() << " samples\n";
+    parser::trace_of<T>::report(std::cout);
+}
+
+// one cached grammar through the samples in turn, each must return and store
+// what G does
+template <typename G>
+void parse_cached(std::initializer_list<const char*> samples) {
+    parser::cached_grammar_t<G> cached;
+    std::size_t same = 0;
+    for (const char* sample : samples) {
+        const char* end = sample + strlen(sample);
+        parser::value_context_t a = parser::value_context_t::local();
+        parser::value_context_t b = a;
+        same += G::parse(sample, end, a) == cached.parse(sample, end, b) && !memcmp(&a.dt, &b.dt, sizeof(datetime))
+            && a.mksec == b.mksec && a.tz.tz_info == b.tz.tz_info && a.tz.hour == b.tz.hour && a.time_unit == b.time_unit;
+    }
+    std::cout << (same == samples.size() ? "ok " : "[!] ") << "cached grammar over " << samples.size() << " samples\n";
+}
+
+// rows one second and a bit apart, the offset changing every 100 rows, parsed
+// straight into a column: every value must come back as parsed alone, and
+// render back to the wall time of its row
+template <typename G>
+void parse_column(std::size_t rows) {
+    std::string buffer;
+    char row[64];
+    for (std::size_t i = 0; i < rows; ++i) {
+        parser::microsec_t mksec;
+        datetime dt;
+        parser::civil::from_epoch(1362504000000000 + static_cast<int64_t>(i) * 1000250, dt, mksec);
+        const int offset = i / 100 % 2 ? -330 : 180;
+        std::snprintf(row, sizeof(row), "%04d-%02u-%02u %02u:%02u:%02u.%06u%c%02d:%02d\n", dt.year, dt.mon, dt.mday,
+                      dt.hour, dt.min, dt.sec, mksec, offset < 0 ? '-' : '+', std::abs(offset) / 60, std::abs(offset) % 60);
+        buffer += row;
+    }
+    buffer += "junk\n";
+    parser::column_t column;
+    const std::size_t count = parser::column<G>::parse(buffer.data(), buffer.data() + buffer.size(), '\n', column);
+    std::vector<char> text(count * batch_expression_t<iso_t>::stride);
+    const std::size_t rendered = batch_expression_t<iso_t>::apply(column, text.data(), '\n');
+    std::size_t same = 0;
+    const char* ptr = buffer.data();
+    for (std::size_t i = 0; i < count; ++i) {
+        const char* end = static_cast<const char*>(memchr(ptr, '\n', buffer.data() + buffer.size() - ptr));
+        parser::epoch_t expected = 0;
+        parser::epoch<G>::parse(ptr, end, expected);
+        int16_t offset;
+        same += column.at(i, &offset) == expected && offset == (i / 100 % 2 ? -330 : 180)
+            && !memcmp(&text[i * batch_expression_t<iso_t>::stride], ptr, iso_t::N);
+        ptr = end + 1;
+    }
+    std::cout << (count == rows && rendered == rows && same == rows ? "ok " : "[!] ") << "column of " << count << " rows in "
+        << column.bytes() << " bytes, " << column.blocks.size() << " blocks :: " << std::string(text.data(), iso_t::N) << "\n";
+}
+
+// random blocks packed at every width and order: the scalar decoder against
+// the values packed, and the AVX2 one against the scalar one when present
+void column_kernels(std::size_t rounds) {
+    using kernel = parser::column_kernel;
+    uint64_t seed = 7;
+    auto next = [&seed] { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed ^ seed >> 29; };
+    std::size_t checked = 0, wrong = 0, avx2 = 0;
+    for (std::size_t round = 0; round < rounds; ++round) {
+        for (unsigned bits = 0; bits <= 64; ++bits) {
+            for (unsigned order = 0; order <= 2; ++order) {
+                uint64_t values[kernel::size], expected[kernel::size], out[kernel::size];
+                std::vector<uint64_t> words(kernel::words(bits), 0);
+                for (auto& v : values) v = bits ? next() >> (64 - bits) : 0;
+                const uint64_t start = next(), step = next();
+                uint64_t sum = start, delta = step;
+                for (std::size_t i = 0; i < kernel::size; ++i) {
+                    const uint64_t v = kernel::unzigzag(values[i]);
+                    expected[i] = order == 0 ? start + v : order == 1 ? (sum += v) : (sum += (delta += v));
+                }
+                kernel::pack(values, bits, words.data());
+                kernel::scalar(words.data(), bits, order, start, step, out);
+                wrong += memcmp(out, expected, sizeof(out)) != 0;
+#if LAZY_X86
+                if (cpu::level() == cpu::level_t::AVX2) {
+                    kernel::avx2(words.data(), bits, order, start, step, out);
+                    wrong += memcmp(out, expected, sizeof(out)) != 0;
+                    ++avx2;
+                }
+#endif
+                ++checked;
+            }
+        }
+    }
+    std::cout << (wrong ? "[!] " : "ok ") << "column kernels: " << checked << " blocks at widths 0-64 and orders 0-2, "
+        << avx2 << " through avx2, " << wrong << " wrong\n";
+}
+
+// detects the shape of the buffer, then every row must parse as through the
+// general grammars
+void parse_detected(const char* buffer, const char* expected_shape, std::initializer_list<const char*> rows) {
+    const parser::detected_t<> detected = parser::detector<>::sample(buffer, buffer + strlen(buffer), '\n', 64);
+    std::size_t same = 0;
+    for (const char* row : rows) {
+        const char* end = row + strlen(row);
+        parser::value_context_t a = parser::value_context_t::local();
+        parser::value_context_t b = a;
+        same += detected.parse(row, end, a) == parser::detect_fallback<parser::value_context_t>::parse<parser::grammar_iso8601>(row, end, b)
+            && !memcmp(&a.dt, &b.dt, sizeof(datetime)) && a.mksec == b.mksec && a.tz.tz_info == b.tz.tz_info && a.tz.hour == b.tz.hour;
+    }
+    std::cout << (detected.name == expected_shape && same == rows.size() ? "ok " : "[!] ") << "detected '" << detected.name
+        << "' on " << detected.matched << "/" << detected.sampled << " sampled rows, " << same << "/" << rows.size() << " rows as expected\n";
+}
+
+template <typename G>
+void parse_batch(const char* buffer, std::size_t expected) {
+    const std::size_t capacity = 64;
+    int32_t year[capacity], tz_offset[capacity];
+    uint32_t mon[capacity], mday[capacity], hour[capacity], min[capacity], sec[capacity];
+    parser::microsec_t mksec[capacity];
+    uint64_t ok[1], utc[1];
+    parser::columns_t out { year, mon, mday, hour, min, sec, mksec, tz_offset, ok, utc };
+    auto count = parser::batch<G>::parse(buffer, buffer + strlen(buffer), '\n', out, capacity);
+    std::cout << (count == expected ? "ok " : "[!] ") << "batch of " << count << " rows\n";
+    for (std::size_t i = 0; i < count; ++i) {
+        std::cout << "  row " << i << ((ok[0] >> i) & 1 ? " parsed. " : " failed. ")
+            << "y = " << year[i] << ", m = " << mon[i] << ", d = " << mday[i]
+            << ", h = " << hour[i] << ", min = " << min[i] << ", sec = " << sec[i]
+            << ", mksec = " << mksec[i];
+        if ((utc[0] >> i) & 1) {
+            std::cout << ", UTC offset: " << tz_offset[i] << "min";
+        } else {
+            std::cout << ", [localtime]";
+        }
+        std::cout << "\n";
+    }
+}
+
+
 int zmain(int argc, char** argv) {
-    char buff[iso_t::N] = {0};
-    datetime now { 2018, 4, 6, 22, 42, 5};
-    char* buff_end = iso_t::apply(buff, now);
-    auto sz = buff_end - buff;
-    *buff_end = 0;
-    std::cout << "result " << sz << "/" << iso_t::N << " bytes :: " << buff << "\n";
+    format<iso_t>({ 2018, 4, 6, 22, 42, 5});
+    format<iso_t>({ 5, 12, 31, 0, 0, 0});
+    format<iso_t>({ -44, 3, 15, 12, 0, 0});
+    format<iso_t>({ 123456789, 3, 5, 17, 38, 26});
+    cached_expression_t<iso_t> cached;
+    format(cached, { 2018, 12, 31, 23, 59, 59});
+    format(cached, { 2019, 1, 1, 0, 0, 0});
+    format(cached, { 12019, 1, 1, 0, 0, 0});
+    format(cached, { 2019, 1, 1, 0, 0, 1});
+    format(cached, { 2019, 1, 1, 0, 0, 1});
+    cached_expression_t<expression_t<tag_hour, tag_char<' '>, tag_ampm>> cached_ampm;
+    format_cached(cached_ampm, { 2019, 1, 1, 1, 0, 0});
+    format_cached(cached_ampm, { 2019, 1, 1, 13, 0, 0});
+    format_cached(cached_ampm, { 2019, 1, 1, 1, 0, 0});
+    format<format_literal<log_format>::expression>({ 2018, 4, 6, 22, 42, 5});
+    format_batch<iso_t>({{ 2018, 4, 6, 22, 42, 5}, { 0, 1, 1, 0, 0, 0}, { 9999, 12, 31, 23, 59, 59}, { 1970, 1, 1, 0, 0, 0},
+                         { 2000, 2, 29, 12, 30, 45}, { 2018, 123, 6, 22, 42, 5}, { 2024, 7, 8, 9, 10, 11}}, 7, '\n');
+    format_batch<iso_t>({{ 2018, 4, 6, 22, 42, 5}, { 2019, 1, 1, 0, 0, 0}, { 2020, 1, 1, 0, 0, 0}, { 2021, 1, 1, 0, 0, 0},
+                         { 2022, 1, 1, 0, 0, 0}, { 12019, 1, 1, 0, 0, 0}, { 2023, 1, 1, 0, 0, 0}}, 5, '\0');
+    format_batch<iso_t>({{ -44, 3, 15, 12, 0, 0}, { 2018, 4, 6, 22, 42, 5}}, 0, '\n');
+    {
+        const parser::epoch_t epochs[] = {0, 1523054525123456, -1, 253402300799000000, 253402300800000000};
+        char buff[5 * batch_expression_t<iso_t>::stride + 1] = {0};
+        const std::size_t count = batch_expression_t<iso_t>::apply(epochs, 5, buff, ' ');
+        std::cout << (count == 4 && !strcmp(buff, "1970-01-01 00:00:00 2018-04-06 22:42:05 1969-12-31 23:59:59 9999-12-31 23:59:59 ") ? "ok " : "[!] ")
+            << "batch format of 5 epochs, " << count << " rows :: " << buff << "\n";
+    }
+    format_batch<format_literal<log_format>::expression>({{ 2018, 4, 6, 22, 42, 5}, { 2019, 1, 1, 0, 0, 0}}, 2, '\n');
+    format<format_literal<compact_format>::expression>({ 2018, 4, 6, 22, 42, 5});
+    format<http_date_t>({ 1994, 11, 15, 8, 12, 31});
+    format<rfc2822_t>({ 2024, 2, 29, 23, 59, 60});
+    format<syslog_t>({ 2003, 10, 1, 22, 14, 15});
+    format<syslog_t>({ 2003, 13, 11, 22, 14, 15});
+    const parser::timezone_t utc { parser::tz_info_t::UTC, 1, 0, 0 };
+    format_pattern("%Y-%m-%d %H:%M:%S", { 2018, 4, 6, 22, 42, 5}, 0, utc);
+    format_pattern("%d/%m/%Y %I:%M:%S %p", { 2018, 4, 6, 0, 42, 5}, 0, utc);
+    format_pattern("%FT%T.%f%z", { 2018, 4, 6, 22, 42, 5}, 68865, { parser::tz_info_t::UTC, -1, 3, 30 });
+    format_pattern("[%Y.%j] 100%%", { 123456789, 0, 256, 0, 0, 0}, 0, utc);
+    format_pattern("%Y-%j", { 2020, 3, 5, 0, 0, 0}, 0, utc, "2020-065");
+    format_pattern("%Y-%j", { 2019, 12, 31, 0, 0, 0}, 0, utc, "2019-365");
+    format_pattern("%Y-%m-%d %Q", { 2018, 4, 6, 22, 42, 5}, 0, utc);
     parse<parser::grammar_date>("2018", true);
     parse<parser::grammar_date>("20181231", true);
     parse<parser::grammar_date>("2018-12", true);
@@ -178,7 +481,11 @@ int zmain(int argc, char** argv) {
     parse<parser::grammar_time>("12:30:11.500000", true);
     parse<parser::grammar_time>("12:30:11.555555", true);
     parse<parser::grammar_time>("12:30:11.5x5555", false);
-    parse<parser::grammar_time>("12:30:11.5555555", false);
+    parse<parser::grammar_time>("12:30:11.5555555", true);
+    parse<parser::grammar_time>("12:30:11.123456789", true);
+    parse<parser::grammar_time>("12:30:11.1234567891", false);
+    parse<parser::grammar_time>("12.123456789", true);
+    parse<parser::grammar_time>("12:30.000000001", true);
 
     parse<parser::grammar_vCard>("--0412", true);
     parse<parser::grammar_vCard>("---12", true);
@@ -207,23 +514,135 @@ int zmain(int argc, char** argv) {
     parse<parser::grammar_generic>("+123456789/03/05 17:38:26.068865+03", true);
     parse<parser::grammar_generic>("-123456789/03/05 17:38:26.068865+03", true);
 
-    return 0;
-}
+    parse<parser::grammar_http_date>("tue, 15 nov 1994 08:12:31 gmt", true);
+    parse<parser::grammar_http_date>("Tue, 15 Nov 1994 08:12:31 EST", false);
+    parse<parser::grammar_http_date>("Tux, 15 Nov 1994 08:12:31 GMT", false);
+    parse<parser::grammar_rfc2822>("Tue, 15 Nov 1994 08:12:31 XYZ", false);
+    parse<parser::validated<parser::grammar_rfc2822>>("32 Nov 1994 08:12 GMT", false);      // the day comes first, so only <= 31
+    parse<parser::grammar_syslog>("Oct 11 22:14:15", true);
+    parse<parser::grammar_syslog>("Oct  1 22:14:15", true);
+    parse<parser::grammar_syslog>("Oct 1 22:14:15", false);
+    parse<parser::grammar_syslog>("Okt 11 22:14:15", false);
+    parse<parser::flat<parser::grammar_http_date>>("tue, 15 nov 1994 08:12:31 gmt", true);
+    parse<parser::flat<parser::grammar_http_date>>("Tue, 15 Nov 1994 08:12:31 EST", false);
+    parse<parser::flat<parser::validated<parser::grammar_rfc2822>>>("32 Nov 1994 08:12 GMT", false);
+    parse<parser::flat<parser::grammar_syslog>>("Oct  1 22:14:15", true);
+    parse<parser::flat<parser::grammar_syslog>>("Okt 11 22:14:15", false);
 
-template <typename G>
-void perf_parse(const char* sample) {
-    datetime dt {0, 0, 0, 0, 0, 0};
-    parser::microsec_t mksec {0};
-    parser::timezone_t tz { parser::tz_info_t::LOCAL, 1, 0, 0 };
-    parser::context_t ctx {dt, mksec, tz, 1, 0, 0, parser::time_unit_t::NONE };
-    const char* end = sample + strlen(sample);
-    parser::grammar_generic::parse(sample, end, ctx);
-};
+    parse<parser::grammar_generic_fast>("2013-03-05 17:38:26", true);
+    parse<parser::grammar_generic_fast>("2013/03/05 17:38:26.068865+03", true);
+    parse<parser::grammar_generic_fast>("2013-03-05 17:38:26.0688651", true);
+    parse<parser::grammar_generic_fast>("2013-03-05 17:38:26.0688651234", false);
+    parse<parser::grammar_generic_fast>("2013-03-05 3:4:5", true);
 
-int main(int argc, char** argv) {
-    for (auto i = 0; i < 100000000; ++i) {
-        perf_parse<parser::grammar_generic>("2013-03-05 17:38:26");
-        //perf_parse<parser::grammar_iso8601>("2017-01-02T03:04:05+05");
+    parse<parser::validated<parser::grammar_generic>>("2013-03-05 17:38:26.068865+03", true);
+    parse<parser::validated<parser::grammar_generic>>("2012-02-29 23:59:60", true);
+    parse<parser::validated<parser::grammar_generic>>("2013-13-05 17:38:26", false);
+    parse<parser::validated<parser::grammar_generic>>("2013-02-29 17:38:26", false);
+    parse<parser::validated<parser::grammar_generic>>("2013-03-05 24:00:00", false);
+    parse<parser::validated<parser::grammar_generic_fast>>("2013-03-05 17:38:26.068865+03", true);
+    parse<parser::validated<parser::grammar_generic_fast>>("2012-02-29 23:59:60", true);
+    parse<parser::validated<parser::grammar_generic_fast>>("2013-02-31 25:61:61", false);
+    parse<parser::validated<parser::grammar_generic_fast>>("2013-03-05 17:61:26", false);
+    parse<parser::validated<parser::grammar_generic>>("2013-03-05 17:38:26+03:60", false);
+    parse<parser::validated<parser::grammar_iso8601>>("2020-366", true);
+    parse<parser::validated<parser::grammar_iso8601>>("2019-366", false);
+    parse<parser::validated<parser::grammar_iso8601>>("2018-W54-1", false);
+    parse<parser::validated<parser::grammar_iso8601>>("2018-W06-8", false);
+    parse<parser::flat<parser::validated<parser::grammar_iso8601>>>("2020-02-30", false);
+
+    parse<format_literal<iso_format>::grammar>("2013-03-05 17:38:26", true);
+    parse<format_literal<iso_format>::grammar>("2013-03-05 3:4:5", false);
+    parse<format_literal<log_format>::grammar>("[2013-03-05 17:38:26]", true);
+    parse<format_literal<compact_format>::grammar>("20130305T173826", true);
+    parse<parser::flat<parser::validated<format_literal<compact_format>::grammar>>>("20130230T173826", false);
+
+    parse_nsec_reused<parser::grammar_iso8601>("2017-01-02T03:04:05.123456789", "2017-01-02T03:04:05.0", 0);
+    parse_nsec_reused<parser::grammar_iso8601>("2017-01-02T03:04:05.123456789", "2017-01-02T03:04:05.5", 500000000);
+
+    parse_epoch<parser::grammar_iso8601>("1970-01-01T00:00:00Z", 0);
+    parse_epoch<parser::grammar_iso8601>("2017-01-02T03:04:05.5-06:30", 1483349645500000);
+    parse_epoch<parser::grammar_iso8601>("2018-W06-1T12:00", 1517832000000000);
+    parse_epoch<parser::grammar_generic>("-290000-01-01 00:00:00", -9213683299200000000);
+    parse_epoch<parser::grammar_generic>("290000-12-31 00:00:00", 9089380396800000000);
+    parse_epoch_out_of_range<parser::grammar_generic>("+123456789-03-05 17:38:26");
+    parse_epoch_out_of_range<parser::grammar_generic>("290001-01-01 00:00:00");
+    parse_epoch<parser::grammar_iso8601>("2018-256", 1536796800000000);
+    parse_epoch<parser::grammar_generic>("1969-12-31 23:59:59.25", -750000);
+    parse_epoch<parser::grammar_rfc2822>("Tue, 15 Nov 1994 08:12:31 GMT", 784887151000000);
+    parse_epoch<parser::grammar_rfc2822>("15 Nov 1994 08:12:31 -0500", 784905151000000);
+    parse_epoch<parser::grammar_rfc2822>("Tue, 15 Nov 1994 08:12:31 EST", 784905151000000);
+    parse_epoch<parser::grammar_rfc2822>("Tue, 15 Nov 1994 08:12 PDT", 784912320000000);
+    parse_epoch<parser::grammar_rfc2822>("1 Oct 2003 06:37 +0200", 1064983020000000);
+    parse_epoch<parser::grammar_http_date>("Tue, 15 Nov 1994 08:12:31 GMT", 784887151000000);
+    parse_epoch<parser::flat<parser::grammar_rfc2822>>("Tue, 15 Nov 1994 08:12 PDT", 784912320000000);
+    parse_epoch<parser::flat<parser::grammar_http_date>>("Tue, 15 Nov 1994 08:12:31 GMT", 784887151000000);
+    parse_epoch<format_literal<http_format>::grammar>("Tue, 15 Nov 1994 08:12:31 GMT", 784887151000000);
+
+    parse_contexts<parser::validated<parser::grammar_generic>>("-2013-03-05 17:38:26.068865+03:30");
+    parse_contexts<parser::validated<parser::grammar_iso8601>>("2018-W06-1T12:30:11.5Z");
+
+    parse_pattern("%d/%m/%Y %I:%M:%S %p", "06/04/2018 10:42:05 pm", true);
+    parse_pattern("%d/%m/%Y %I:%M:%S %p", "06/04/2018 12:42:05 AM", true, "06/04/2018 12:42:05 AM");
+    parse_pattern("%H:%M %p", "15:00 AM", true, "15:00 PM");        // %p folds %I only
+    parse_pattern("%I:%M %p", "03:00 PM", true, "03:00 PM");
+    parse_pattern("%FT%T.%f%z", "2018-04-06T22:42:05.068865-03:30", true);
+    parse_pattern("%FT%T.%f%z", "2018-04-06T22:42:05.068865", false);
+    parse_pattern("%Y.%j", "2018.256", true);
+
+    parser::zone_t cet;
+    cet.load_rule("CET-1CEST,M3.5.0,M10.5.0/3");
+    parse_zone(cet, "CET", "2021-01-15 12:00:00", 1610708400000000);
+    parse_zone(cet, "CET", "2021-07-15 12:00:00", 1626343200000000);
+    parse_zone(cet, "CET", "2021-03-28 02:30:00", 1616895000000000);      // skipped over, moved forward
+    parse_zone(cet, "CET", "2021-10-31 02:30:00", 1635640200000000);      // twice, the first one
+    parse_zone(cet, "CET", "2150-07-01 12:00:00", 5695956000000000);
+    parse_zone(cet, "CET", "2021-07-15 12:00:00+03", 1626339600000000);
+    parser::zone_t new_york;
+    if (new_york.load_file("America/New_York")) {
+        parse_zone(new_york, "America/New_York", "2021-11-07 01:30:00", 1636263000000000);
+        parse_zone(new_york, "America/New_York", "1970-01-01 00:00:00", 18000000000);
+    } else {
+        std::cout << "America/New_York not found, skipped\n";
     }
+
+    parse_view<parser::grammar_iso8601>("2017-01-02T03:04:05.5Z", "2017-01-02T03:04:05.4Z");
+    parse_view<parser::grammar_iso8601>("2017-01-02T03:04:05.5Z", "2017-01-02T03:04:05.50Z");
+    parse_view<parser::grammar_iso8601>("2017-01-02T03:04:05-06:30", "2017-01-02T09:30:05Z");
+    parse_view<parser::grammar_iso8601>("2018-256T12:30.5", "2018-W37-4T12:30:30");
+    parse_view<parser::grammar_generic>("-2013-03-05 17:38:26", "2013/03/05 17:38:26");
+
+    parse_traced<parser::grammar_date>({"2018-12-31", "2018-W06-1", "2018256", "2018-12", "20181231", "2018-1"});
+
+    parse_cached<parser::grammar_generic>({"2013-03-05 17:38:26", "2013-03-05 17:38:27.5+03", "2013-03-05 18:00:00",
+        "2013-03-05 18:0", "2013-03-05", "2013-03-051", "-2013-03-05 18:00:00", "2013/03/05 18:00:01"});
+    parse_column<parser::grammar_generic>(300);
+    parse_column<parser::grammar_generic>(128);
+    column_kernels(16);
+
+    parse_detected("2013-03-05T17:38:26.5Z\n2013-03-05T17:38:27.25Z\n2013-03-05T17:38:28Z\n2013-03-05T17:38:29.125Z\n",
+        "iso8601 YYYY-MM-DDThh:mm:ss.fZ", {"2013-03-05T17:38:30.5Z", "2013-03-05T17:38:31Z", "2013-03-05 17:38:32", "20130305", "junk"});
+    parse_detected("20130305T173826+0300\n20130305T173827+0300\n", "iso8601 YYYYMMDDThhmmss+hh[[:]mm]",
+        {"20130305T173828+03:00", "20130305T1738", "Oct  1 22:14:15"});
+    parse_detected("2013/03/05 17:38:26\n2013/03/05 17:38:27\n", "generic Y-MM-DD h:m:s", {"2013-03-05 17:38:28", "-2013-03-05 17:38:28"});
+    parse_detected("Tue, 15 Nov 1994 08:12:31 GMT\n", "http_date", {"Tue, 15 Nov 1994 08:12:32 GMT", "15 Nov 1994 08:12 EST"});
+    parse_detected("not a date\n", "", {"2013-03-05", "Oct  1 22:14:15", "junk"});
+    parse_cached<parser::validated<parser::grammar_generic>>({"2013-02-28 23:59:59", "2013-02-28 24:00:00",
+        "2013-02-28 23:60:00", "2013-02-29 00:00:00", "2012-02-29 00:00:00"});
+
+    parse_stream<parser::grammar_iso8601>("2017-01-02T03:04:05.5-06:30");
+    parse_stream<parser::grammar_iso8601>("2018-W06-1T12:00");
+    parse_stream<parser::grammar_generic>("2013/03/05 17:38:26.068865+03");
+    parse_stream<parser::grammar_rfc2822>("Tue, 15 Nov 1994 08:12:31 EST");
+    parse_stream<parser::grammar_http_date>("Tue, 15 Nov 1994 08:12:31 GMT");
+    parse_stream<parser::grammar_syslog>("Oct  1 22:14:15");
+
+    parse_batch<parser::grammar_generic>("2013-03-05 17:38:26\n2013/03/05 17:38:26.068865+03\nxxxx\n-2013-03-05 17:38:26-03:30", 4);
+
     return 0;
 }
+
+// the samples; the benchmarks proper are in lazy-stingization-bench
+int main(int argc, char** argv) {
+    return zmain(argc, argv);
+}
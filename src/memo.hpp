@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstring>
+#include "iso8601.hpp"
+#include "fast_path.hpp"
+#include "validate.hpp"
+
+namespace parser {
+
+// the parts of grammar_generic which follow "YYYY-MM-DD" and "YYYY-MM-DD HH:",
+// see grammar_generic
+using grammar_generic_after_hour = op_seq<term_min_v, term_char<':'>, term_sec_v, grammar_generic_after_sec>;
+using grammar_generic_after_day  = op_maybe<op_seq<term_char<' '>, term_hour_v, term_char<':'>, grammar_generic_after_hour>>;
+
+// how a grammar resumes after a remembered prefix: the handlers of the prefix
+// fields and the rest of the grammar
+template <typename G> struct prefix_of;
+template <> struct prefix_of<grammar_generic> {
+    using year = handler_year_v;
+    using month = handler_month;
+    using day = handler_day;
+    using hour = handler_hour_v;
+    using after_day = grammar_generic_after_day;
+    using after_hour = grammar_generic_after_hour;
+};
+template <> struct prefix_of<validated<grammar_generic>> {
+    using year = checked<handler_year_v>;
+    using month = checked<handler_month>;
+    using day = checked<handler_day>;
+    using hour = checked<handler_hour_v>;
+    using after_day = validated<grammar_generic_after_day>;
+    using after_hour = validated<grammar_generic_after_hour>;
+};
+
+// Remembers the "YYYY-MM-DD" and "YYYY-MM-DD HH:" bytes of the last input G
+// went through and their values. An input with the same prefix, compared as
+// two or three overlapping 8 bytes words, gets the prefix handlers called with
+// the remembered values, in the order G calls them, and only the rest of the
+// grammar is run, so the results are the ones of G. Any other input is
+// parsed by G and remembered. Not thread-safe: meant to be one instance per
+// thread or per input stream.
+template <typename G>
+class cached_grammar_t {
+public:
+    template <typename Context>
+    inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        using P = prefix_of<G>;
+        const std::ptrdiff_t size = ptr_end - ptr;
+        if (size >= hour_size && cached == hour_size && same(ptr, hour_size)) {
+            if (!replay(ctx)) return G::parse(ptr, ptr_end, ctx);
+            if (!invoke_handler<typename P::hour>(hour, 2, ctx)) return ptr + date_size;
+            const char* result = P::after_hour::parse(ptr + hour_size, ptr_end, ctx);
+            return result ? result : ptr + date_size;
+        }
+        if (size >= date_size && cached && same(ptr, date_size)) {
+            if (!replay(ctx)) return G::parse(ptr, ptr_end, ctx);
+            const char* result = P::after_day::parse(ptr + date_size, ptr_end, ctx);
+            remember_hour(ptr, result);
+            return result;
+        }
+        const char* result = G::parse(ptr, ptr_end, ctx);
+        remember(ptr, result);
+        return result;
+    }
+
+private:
+    static const int date_size = 10;
+    static const int hour_size = 14;
+
+    static inline uint64_t word(const char* ptr) {
+        uint64_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    static inline unsigned digit(const char* ptr) {
+        return static_cast<unsigned>(static_cast<unsigned char>(*ptr)) - '0';
+    }
+
+    inline bool same(const char* ptr, int size) const {
+        const bool date = (word(ptr) ^ words[0]) | (word(ptr + 2) ^ words[1]);
+        if (size == date_size) return !date;
+        return !(date | (word(ptr + 6) != words[2]));
+    }
+
+    template <typename Context>
+    inline bool replay(Context& ctx) const {
+        using P = prefix_of<G>;
+        return invoke_handler<typename P::year>(year, 4, ctx) && invoke_handler<typename P::month>(month, ctx)
+            && invoke_handler<typename P::day>(day, ctx);
+    }
+
+    // G went through "YYYY-MM-DD" exactly when the year has 4 digits and the
+    // parse got past the day
+    inline void remember(const char* ptr, const char* result) {
+        cached = 0;
+        if (!result || result - ptr < date_size) return;
+        if ((ptr[4] != '-' && ptr[4] != '/') || (ptr[7] != '-' && ptr[7] != '/')) return;
+        static const unsigned char positions[] = {0, 1, 2, 3, 5, 6, 8, 9};
+        for (unsigned char p : positions) {
+            if (digit(ptr + p) > 9) return;
+        }
+        year = ((digit(ptr) * 10 + digit(ptr + 1)) * 10 + digit(ptr + 2)) * 10 + digit(ptr + 3);
+        month = digit(ptr + 5) * 10 + digit(ptr + 6);
+        day = digit(ptr + 8) * 10 + digit(ptr + 9);
+        words[0] = word(ptr);
+        words[1] = word(ptr + 2);
+        cached = date_size;
+        remember_hour(ptr, result);
+    }
+
+    // " HH:" went through term_hour_v when the parse got past it
+    inline void remember_hour(const char* ptr, const char* result) {
+        cached = date_size;
+        if (!result || result - ptr < hour_size) return;
+        if (ptr[10] != ' ' || digit(ptr + 11) > 9 || digit(ptr + 12) > 9 || ptr[13] != ':') return;
+        hour = digit(ptr + 11) * 10 + digit(ptr + 12);
+        words[2] = word(ptr + 6);
+        cached = hour_size;
+    }
+
+    uint64_t words[3] = {0, 0, 0};                  // bytes [0, 8), [2, 10) and [6, 14)
+    int cached = 0;                                 // 0, date_size or hour_size bytes remembered
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    int hour = 0;
+};
+
+}
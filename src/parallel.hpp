@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "batch.hpp"
+
+namespace parser {
+
+// batch<G> over a pool of threads. Rows are cut into chunks of chunk_rows, each
+// worker starts with a contiguous run of chunks and, once it is done, steals
+// half of what is left to another one; uneven rows get balanced without any
+// shared counter on the hot path. A chunk is a whole number of ok/utc words
+// and a contiguous slice of every column, so workers never write the same word.
+template <typename G>
+struct parallel_batch {
+    static const std::size_t chunk_rows = 64 * 64;
+
+    // threads == 0 picks hardware_concurrency(); the calling thread is worker 0
+    static inline std::size_t parse(const range_t* rows, std::size_t count, columns_t& out, unsigned threads = 0) {
+        if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+        const std::size_t chunks = (count + chunk_rows - 1) / chunk_rows;
+        if (threads > chunks) threads = static_cast<unsigned>(std::max<std::size_t>(1, chunks));
+
+        std::vector<queue_t> queues(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            queues[i].range.store(pack(chunks * i / threads, chunks * (i + 1) / threads), std::memory_order_relaxed);
+        }
+        std::vector<std::size_t> parsed(threads, 0);
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([&, i] { parsed[i] = work(i, queues, rows, count, out); });
+        }
+        parsed[0] = work(0, queues, rows, count, out);
+        for (auto& w : workers) w.join();
+
+        std::size_t total = 0;
+        for (auto p : parsed) total += p;
+        return total;
+    }
+
+private:
+    // [begin, end) chunk indices, begin in the low half; the owner pops at
+    // begin, thieves cut at end, both with a CAS on the same word
+    // one cache line per queue, the vector storage too through aligned new
+    struct alignas(64) queue_t {
+        std::atomic<uint64_t> range;
+    };
+
+    static inline uint64_t pack(uint64_t begin, uint64_t end) { return begin | (end << 32); }
+
+    static inline bool pop(queue_t& q, std::size_t& chunk) {
+        uint64_t v = q.range.load(std::memory_order_relaxed);
+        for (;;) {
+            const uint32_t begin = static_cast<uint32_t>(v), end = static_cast<uint32_t>(v >> 32);
+            if (begin >= end) return false;
+            if (q.range.compare_exchange_weak(v, pack(begin + 1, end), std::memory_order_relaxed)) {
+                chunk = begin;
+                return true;
+            }
+        }
+    }
+
+    // moves the upper half of the victim's chunks to the (empty) own queue
+    static inline bool steal(queue_t& victim, queue_t& own) {
+        uint64_t v = victim.range.load(std::memory_order_relaxed);
+        for (;;) {
+            const uint32_t begin = static_cast<uint32_t>(v), end = static_cast<uint32_t>(v >> 32);
+            if (begin >= end) return false;
+            const uint32_t mid = end - (end - begin + 1) / 2;
+            if (victim.range.compare_exchange_weak(v, pack(begin, mid), std::memory_order_relaxed)) {
+                own.range.store(pack(mid, end), std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    static inline std::size_t work(unsigned self, std::vector<queue_t>& queues,
+                                   const range_t* rows, std::size_t count, const columns_t& out) {
+        const unsigned n = static_cast<unsigned>(queues.size());
+        std::size_t parsed = 0, chunk;
+        for (;;) {
+            while (pop(queues[self], chunk)) {
+                const std::size_t base = chunk * chunk_rows;
+                columns_t slice = offset(out, base);
+                parsed += batch<G>::parse(rows + base, std::min(chunk_rows, count - base), slice);
+            }
+            unsigned i = 1;
+            while (i < n && !steal(queues[(self + i) % n], queues[self])) ++i;
+            if (i == n) return parsed;                  // in flight chunks are finished by their thief
+        }
+    }
+
+    static inline columns_t offset(const columns_t& c, std::size_t base) {
+        return columns_t {
+            c.year + base, c.mon + base, c.mday + base, c.hour + base, c.min + base, c.sec + base,
+            c.mksec + base, c.tz_offset + base, c.ok + base / 64, c.utc + base / 64
+        };
+    }
+};
+
+template <typename G> const std::size_t parallel_batch<G>::chunk_rows;
+
+}
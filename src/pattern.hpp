@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstring>
+#include "iso8601.hpp"
+#include "epoch.hpp"
+#include "formatter.hpp"
+
+// A strftime-like pattern compiled once at runtime into a flat program of
+// fields at fixed offsets of a rendered template, i.e. what expression_t does
+// at compile time: formatting is one memcpy of the template plus the digit
+// stores, parsing walks the same fields through the grammar handlers.
+//
+//   %Y year (4 digits)  %m month  %d day  %j day of year (3 digits)
+//   %H hour  %I hour (1-12)  %M minute  %S second  %p AM/PM
+//   %f microseconds (6 digits; parsing takes 1-9)
+//   %z offset, +HHMM (parsing takes Z, +HH, +HHMM and +HH:MM)
+//   %F = %Y-%m-%d  %T = %H:%M:%S  %% = %
+struct pattern_t {
+    // the plain 2 digits fields come first, see format()
+    enum class field_t : uint8_t { MONTH, DAY, HOUR, MINUTE, SECOND, YEAR, ORDINAL, HOUR12, AMPM, FRACTION, TZ, LITERAL };
+
+    // size: literal bytes or field width, offset: position in the template,
+    // source: index of the field in datetime
+    struct op_t {
+        field_t field;
+        uint8_t offset;
+        uint8_t size;
+        uint8_t source;
+    };
+
+    static const std::size_t max_ops = 32;
+    static const std::size_t max_size = 64;
+
+    pattern_t(): count{0}, fields{0}, N{0}, has_year{false}, has_ampm{false} {}
+
+    // false on an unknown conversion or a pattern beyond the limits above
+    bool compile(const char* pattern) {
+        count = fields = N = 0;
+        has_year = has_ampm = false;
+        if (!append(pattern)) return false;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (ops[i].field != field_t::LITERAL) slots[fields++] = ops[i];
+        }
+        return true;
+    }
+
+    // rendered size, unless the year does not fit 4 digits
+    std::size_t size() const { return N; }
+
+    inline char* format(char* out, const datetime& dt) const {
+        return format(out, dt, 0, parser::timezone_t{parser::tz_info_t::UTC, 1, 0, 0});
+    }
+
+    inline char* format(char* out, const datetime& dt, parser::microsec_t mksec, const parser::timezone_t& tz) const {
+        if (has_year && (dt.year < 0 || dt.year > 9999)) return compose(out, dt, mksec, tz);
+        uint32_t values[6];                         // year, mon, mday, hour, min, sec
+        static_assert(sizeof(values) == sizeof(datetime), "datetime is expected to be 6 32-bit fields");
+        std::memcpy(values, &dt, sizeof(values));
+        std::memcpy(out, literal, N);
+        for (std::size_t i = 0; i < fields; ++i) {
+            const op_t& op = slots[i];
+            if (op.field <= field_t::SECOND) {
+                tag_t<2>::apply2(out + op.offset, values[op.source]);
+            } else if (op.field == field_t::YEAR) {
+                digits::write4(out + op.offset, values[0]);
+            } else {
+                write(out + op.offset, op.field, dt, mksec, tz);
+            }
+        }
+        return out + N;
+    }
+
+    // like the grammars: the end of the match or NULL
+    template <typename Context>
+    const char* parse(const char* ptr, const char* ptr_end, Context& ctx) const {
+        bool pm = false;
+        bool hour12 = false;                        // the last hour was %I, folded by %p
+        for (std::size_t i = 0; i < count; ++i) {
+            const op_t& op = ops[i];
+            switch (op.field) {
+            case field_t::LITERAL:                  // mostly single separators, no memcmp call
+                if (ptr_end - ptr < op.size) return NULL;
+                for (const char* it = literal + op.offset; it != literal + op.offset + op.size; ++it, ++ptr) {
+                    if (*ptr != *it) return NULL;
+                }
+                break;
+            case field_t::YEAR:     ptr = parser::term_year::parse(ptr, ptr_end, ctx); break;
+            case field_t::MONTH:    ptr = parser::term_month::parse(ptr, ptr_end, ctx); break;
+            case field_t::DAY:      ptr = parser::term_day::parse(ptr, ptr_end, ctx); break;
+            case field_t::ORDINAL:  ptr = parser::term_ordinal_date::parse(ptr, ptr_end, ctx); break;
+            case field_t::HOUR:     ptr = parser::term_hour::parse(ptr, ptr_end, ctx); hour12 = false; break;
+            case field_t::HOUR12:   ptr = parser::term_hour::parse(ptr, ptr_end, ctx); hour12 = true; break;
+            case field_t::MINUTE:   ptr = parser::term_min::parse(ptr, ptr_end, ctx); break;
+            case field_t::SECOND:   ptr = parser::term_sec::parse(ptr, ptr_end, ctx); break;
+            case field_t::FRACTION: ptr = parser::term_fraction_p::parse(ptr, ptr_end, ctx); break;
+            case field_t::TZ:       ptr = parser::grammar_tz::parse(ptr, ptr_end, ctx); break;
+            case field_t::AMPM:
+                if (ptr_end - ptr < 2 || (ptr[1] | 0x20) != 'm') return NULL;
+                if ((ptr[0] | 0x20) == 'p') pm = true;
+                else if ((ptr[0] | 0x20) != 'a') return NULL;
+                ptr += 2;
+                break;
+            }
+            if (!ptr) return NULL;
+        }
+        if (has_ampm && hour12) ctx.dt.hour = ctx.dt.hour % 12 + (pm ? 12 : 0);
+        return ptr;
+    }
+
+private:
+    bool append(const char* pattern) {
+        for (const char* it = pattern; *it; ++it) {
+            if (*it != '%') {
+                if (!add(field_t::LITERAL, 1, *it)) return false;
+                continue;
+            }
+            bool ok;
+            switch (*++it) {
+            case 'Y': ok = add(field_t::YEAR, 4, '0'); has_year = true; break;
+            case 'm': ok = add(field_t::MONTH, 2, '0', 1); break;
+            case 'd': ok = add(field_t::DAY, 2, '0', 2); break;
+            case 'j': ok = add(field_t::ORDINAL, 3, '0'); break;
+            case 'H': ok = add(field_t::HOUR, 2, '0', 3); break;
+            case 'I': ok = add(field_t::HOUR12, 2, '0'); break;
+            case 'M': ok = add(field_t::MINUTE, 2, '0', 4); break;
+            case 'S': ok = add(field_t::SECOND, 2, '0', 5); break;
+            case 'p': ok = add(field_t::AMPM, 2, 'M'); if (ok) literal[N - 2] = 'A'; has_ampm = true; break;
+            case 'f': ok = add(field_t::FRACTION, 6, '0'); break;
+            case 'z': ok = add(field_t::TZ, 5, '0'); break;
+            case 'F': ok = append("%Y-%m-%d"); break;
+            case 'T': ok = append("%H:%M:%S"); break;
+            case '%': ok = add(field_t::LITERAL, 1, '%'); break;
+            default: return false;
+            }
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    // literal bytes extend the previous literal op
+    bool add(field_t field, std::size_t size, char fill, uint8_t source = 0) {
+        if (N + size > max_size) return false;
+        if (field == field_t::LITERAL && count && ops[count - 1].field == field_t::LITERAL) {
+            ++ops[count - 1].size;
+        } else {
+            if (count == max_ops) return false;
+            ops[count++] = op_t{field, static_cast<uint8_t>(N), static_cast<uint8_t>(size), source};
+        }
+        std::memset(literal + N, fill, size);
+        N += size;
+        return true;
+    }
+
+    static inline uint32_t hour12(uint32_t hour) {
+        const uint32_t value = hour % 12;
+        return value ? value : 12;
+    }
+
+    // a date without month (YYYY-DDD) keeps the day of the year in mday
+    static inline uint32_t ordinal(const datetime& dt) {
+        if (!dt.mon) return dt.mday;
+        return static_cast<uint32_t>(parser::civil::days_from_civil(dt.year, dt.mon, dt.mday) - parser::civil::days_from_civil(dt.year, 1, 1) + 1);
+    }
+
+    static inline void write_ordinal(char* in, uint32_t day) {
+        *in = static_cast<char>('0' + day / 100 % 10);
+        tag_t<2>::apply2(in + 1, day % 100);
+    }
+
+    static inline void write(char* in, field_t field, const datetime& dt, parser::microsec_t mksec, const parser::timezone_t& tz) {
+        switch (field) {
+        case field_t::LITERAL:  break;
+        case field_t::YEAR:     digits::write4(in, dt.year); break;
+        case field_t::MONTH:    tag_t<2>::apply2(in, dt.mon); break;
+        case field_t::DAY:      tag_t<2>::apply2(in, dt.mday); break;
+        case field_t::ORDINAL:  write_ordinal(in, ordinal(dt)); break;
+        case field_t::HOUR:     tag_t<2>::apply2(in, dt.hour); break;
+        case field_t::HOUR12:   digits::write2(in, hour12(dt.hour)); break;
+        case field_t::MINUTE:   tag_t<2>::apply2(in, dt.min); break;
+        case field_t::SECOND:   tag_t<2>::apply2(in, dt.sec); break;
+        case field_t::AMPM:     if (dt.hour >= 12) *in = 'P'; break;
+        case field_t::FRACTION: digits::write4(digits::write2(in, mksec / 10000 % 100), mksec % 10000); break;
+        case field_t::TZ:
+            *in = tz.sign < 0 ? '-' : '+';
+            digits::write2(digits::write2(in + 1, tz.hour % 100), tz.minute % 100);
+            break;
+        }
+    }
+
+    // the year does not fit its slot: every op in turn
+    char* compose(char* out, const datetime& dt, parser::microsec_t mksec, const parser::timezone_t& tz) const {
+        for (std::size_t i = 0; i < count; ++i) {
+            const op_t& op = ops[i];
+            if (op.field == field_t::YEAR) {
+                out = digits::write(out, dt.year);
+                continue;
+            }
+            std::memcpy(out, literal + op.offset, op.size);
+            write(out, op.field, dt, mksec, tz);
+            out += op.size;
+        }
+        return out;
+    }
+
+    op_t ops[max_ops];
+    op_t slots[max_ops];                            // ops without the literals
+    std::size_t count;
+    std::size_t fields;
+    std::size_t N;
+    char literal[max_size];
+    bool has_year;
+    bool has_ampm;
+};
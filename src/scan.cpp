@@ -0,0 +1,269 @@
+// timestamp-scan: parses the leading timestamp of every line of memory mapped
+// log files, one newline aligned range per thread; prints either the epoch
+// microseconds of every line or a min/max/histogram summary. Timestamps
+// without an offset are taken in --zone, UTC by default. A line counts as
+// parsed when the timestamp is the whole line; with --prefix it may be
+// followed by text after a space, tab, ',', ';' or '|', and then a leading
+// bare number such as "404 Not Found" is taken as a year.
+//
+//   timestamp-scan [--grammar=generic|fast|iso8601] [--mode=lines|summary] [--prefix]
+//                  [--threads=N] [--bucket=SECONDS] [--zone=NAME] file...
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "iso8601.hpp"
+#include "fast_path.hpp"
+#include "epoch.hpp"
+#include "zone.hpp"
+#include "formatter.hpp"
+
+namespace {
+
+enum class output_t { LINES, SUMMARY };
+
+struct options_t {
+    std::string grammar = "generic";
+    output_t mode = output_t::SUMMARY;
+    bool prefix = false;                                    // trailing text allowed after a delimiter
+    unsigned threads = 0;
+    int64_t bucket = 3600;                                  // histogram bucket, seconds
+    parser::zone_t zone;                                    // shared by the threads, UTC unless loaded
+};
+
+// per thread, merged once at the end
+struct summary_t {
+    uint64_t lines = 0;
+    uint64_t parsed = 0;
+    parser::epoch_t min = INT64_MAX;
+    parser::epoch_t max = INT64_MIN;
+    std::map<int64_t, uint64_t> histogram;                  // bucket index -> lines
+
+    void merge(const summary_t& other) {
+        lines += other.lines;
+        parsed += other.parsed;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        for (const auto& it : other.histogram) histogram[it.first] += it.second;
+    }
+};
+
+// floor division, so that the buckets before 1970 are as wide as the others
+static inline int64_t bucket_of(parser::epoch_t value, int64_t width) {
+    const int64_t q = value / width;
+    return q - (value % width < 0);
+}
+
+// the end of the match against the end of the line, a CR of CRLF included
+static inline bool taken(const char* result, const char* eol, bool prefix) {
+    if (!result) return false;
+    if (result == eol || (result + 1 == eol && *result == '\r')) return true;
+    return prefix && (*result == ' ' || *result == '\t' || *result == ',' || *result == ';' || *result == '|');
+}
+
+template <typename G>
+struct scanner {
+    // a line counts as parsed when the grammar matches at its very start, see taken()
+    static void summary(const char* ptr, const char* ptr_end, int64_t width, bool prefix, const parser::zone_t& zone, summary_t& out) {
+        int64_t last_bucket = INT64_MIN;
+        uint64_t* last_count = nullptr;
+        while (ptr < ptr_end) {
+            const char* eol = static_cast<const char*>(std::memchr(ptr, '\n', ptr_end - ptr));
+            if (!eol) eol = ptr_end;
+            parser::epoch_t value;
+            ++out.lines;
+            if (taken(parser::epoch<G>::parse(ptr, eol, value, zone), eol, prefix)) {
+                ++out.parsed;
+                out.min = std::min(out.min, value);
+                out.max = std::max(out.max, value);
+                const int64_t bucket = bucket_of(value, width);
+                if (bucket != last_bucket) {
+                    last_bucket = bucket;
+                    last_count = &out.histogram[bucket];
+                }
+                ++*last_count;
+            }
+            ptr = eol + 1;
+        }
+    }
+
+    // "<epoch microseconds>\n" or "-\n" per line
+    static void lines(const char* ptr, const char* ptr_end, bool prefix, const parser::zone_t& zone, std::vector<char>& out, summary_t& stats) {
+        char buff[24];
+        while (ptr < ptr_end) {
+            const char* eol = static_cast<const char*>(std::memchr(ptr, '\n', ptr_end - ptr));
+            if (!eol) eol = ptr_end;
+            parser::epoch_t value;
+            ++stats.lines;
+            char* end = buff;
+            if (taken(parser::epoch<G>::parse(ptr, eol, value, zone), eol, prefix)) {
+                ++stats.parsed;
+                end = digits::write(buff, value);
+            } else {
+                *(end++) = '-';
+            }
+            *(end++) = '\n';
+            out.insert(out.end(), buff, end);
+            ptr = eol + 1;
+        }
+    }
+};
+
+// range i of n, both ends moved forward to the next line start
+static const char* split(const char* begin, const char* end, std::size_t i, std::size_t n) {
+    if (i == 0) return begin;
+    if (i == n) return end;
+    const char* ptr = begin + (end - begin) / n * i;
+    if (ptr == begin) return begin;
+    const char* eol = static_cast<const char*>(std::memchr(ptr - 1, '\n', end - ptr + 1));
+    return eol ? eol + 1 : end;
+}
+
+template <typename G>
+void scan(const char* begin, const char* end, const options_t& opt, summary_t& total) {
+    const std::size_t n = opt.threads;
+    std::vector<summary_t> stats(n);
+    std::vector<std::thread> workers;
+    if (opt.mode == output_t::SUMMARY) {
+        for (std::size_t i = 0; i < n; ++i) {
+            workers.emplace_back([&, i] {
+                scanner<G>::summary(split(begin, end, i, n), split(begin, end, i + 1, n), opt.bucket * 1000000, opt.prefix, opt.zone, stats[i]);
+            });
+        }
+        for (auto& w : workers) w.join();
+    } else {
+        // windows keep the output buffers bounded; each one is written in order
+        const std::size_t window = std::size_t(64) << 20;
+        std::vector<std::vector<char>> outputs(n);
+        for (const char* ptr = begin; ptr < end;) {
+            const char* window_end = split(ptr, end, 1, std::max<std::size_t>(1, (end - ptr) / window));
+            workers.clear();
+            for (std::size_t i = 0; i < n; ++i) {
+                outputs[i].clear();
+                workers.emplace_back([&, i] {
+                    scanner<G>::lines(split(ptr, window_end, i, n), split(ptr, window_end, i + 1, n), opt.prefix, opt.zone, outputs[i], stats[i]);
+                });
+            }
+            for (auto& w : workers) w.join();
+            for (const auto& o : outputs) std::fwrite(o.data(), 1, o.size(), stdout);
+            ptr = window_end;
+        }
+    }
+    for (const auto& s : stats) total.merge(s);
+}
+
+bool scan_file(const char* path, const options_t& opt, summary_t& total) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        std::perror(path);
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::perror(path);
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    const char* begin = static_cast<const char*>(map);
+    const char* end = begin + st.st_size;
+    if (opt.grammar == "generic") {
+        scan<parser::grammar_generic>(begin, end, opt, total);
+    } else if (opt.grammar == "fast") {
+        scan<parser::grammar_generic_fast>(begin, end, opt, total);
+    } else {
+        scan<parser::grammar_iso8601>(begin, end, opt, total);
+    }
+    munmap(map, st.st_size);
+    return true;
+}
+
+int usage(const char* name) {
+    std::fprintf(stderr, "usage: %s [--grammar=generic|fast|iso8601] [--mode=lines|summary] [--prefix] "
+                         "[--threads=N] [--bucket=SECONDS] [--zone=NAME] file...\n"
+                         "  a line is parsed when the timestamp is the whole line; with --prefix it may be\n"
+                         "  followed by text after a space, tab, ',', ';' or '|', a bare leading number then\n"
+                         "  counts as a year\n", name);
+    return 2;
+}
+
+}
+
+int main(int argc, char** argv) {
+    options_t opt;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (!std::strncmp(arg, "--grammar=", 10)) {
+            opt.grammar = arg + 10;
+            if (opt.grammar != "generic" && opt.grammar != "fast" && opt.grammar != "iso8601") return usage(argv[0]);
+        } else if (!std::strcmp(arg, "--mode=lines")) {
+            opt.mode = output_t::LINES;
+        } else if (!std::strcmp(arg, "--mode=summary")) {
+            opt.mode = output_t::SUMMARY;
+        } else if (!std::strcmp(arg, "--prefix")) {
+            opt.prefix = true;
+        } else if (!std::strncmp(arg, "--threads=", 10)) {
+            char* end;
+            const unsigned long threads = std::strtoul(arg + 10, &end, 10);
+            if (arg[10] < '0' || arg[10] > '9' || *end || !threads || threads > UINT_MAX) return usage(argv[0]);
+            opt.threads = static_cast<unsigned>(threads);
+        } else if (!std::strncmp(arg, "--bucket=", 9)) {
+            opt.bucket = std::atoll(arg + 9);
+            if (opt.bucket <= 0) return usage(argv[0]);
+        } else if (!std::strncmp(arg, "--zone=", 7)) {
+            if (!opt.zone.load_file(arg + 7)) {
+                std::fprintf(stderr, "%s: unknown zone\n", arg + 7);
+                return 2;
+            }
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            return usage(argv[0]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) return usage(argv[0]);
+    if (!opt.threads) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    summary_t total;
+    bool ok = true;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const char* path : files) ok = scan_file(path, opt, total) && ok;
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::FILE* report = opt.mode == output_t::SUMMARY ? stdout : stderr;
+    std::fprintf(report, "lines: %llu, parsed: %llu, threads: %u, %.3f s\n",
+                 static_cast<unsigned long long>(total.lines), static_cast<unsigned long long>(total.parsed),
+                 opt.threads, elapsed);
+    if (opt.mode == output_t::SUMMARY && total.parsed) {
+        std::fprintf(report, "min: %lld us\nmax: %lld us\n",
+                     static_cast<long long>(total.min), static_cast<long long>(total.max));
+        for (const auto& it : total.histogram) {
+            std::fprintf(report, "%lld %llu\n", static_cast<long long>(it.first * opt.bucket),
+                         static_cast<unsigned long long>(it.second));
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstring>
+#include "flat.hpp"
+
+namespace parser {
+
+// Resumable variant of flat<G> for timestamps split across input chunks.
+// All the engine state lives in a POD: the instruction index, the backtrack
+// stack and the digit accumulator of a number cut in the middle. Positions are
+// offsets within the timestamp, so a chunk is read in place; only the bytes of
+// a timestamp which has to wait for the next chunk are kept in a small carry,
+// as an alternative may still have to backtrack into them.
+//
+// The context is the caller's, it must be the same one for every chunk of a
+// timestamp; handlers fire exactly as when parsing the whole string at once.
+
+enum class stream_status_t : uint8_t { DONE, MORE, FAIL };
+
+template <typename G, typename Context = context_t>
+struct stream {
+    using code = program<G, Context>;
+    static const uint32_t carry_size = 64;          // longest timestamp which may straddle chunks
+
+    struct frame_t { uint32_t pc; uint32_t pos; };
+
+    // a value-initialized state_t{} starts a new timestamp
+    struct state_t {
+        uint32_t pc;                                // next instruction
+        uint32_t pos;                               // offset within the timestamp
+        uint32_t top;                               // pending alternatives
+        int32_t value;                              // digits of the current number or bytes of the keyword so far
+        uint32_t digits;
+        uint32_t carry_len;                         // bytes of the previous chunks
+        frame_t stack[code::depth + 1];
+        char carry[carry_size];
+    };
+
+    // feeds the next chunk, ptr is moved past the timestamp on DONE. MORE means
+    // the whole chunk was taken and the timestamp may go on in the next one.
+    // On DONE the match may end before the chunk, after a backtrack into the
+    // carry; then ptr is left as is and the unused bytes are carry[pos, carry_len).
+    static inline stream_status_t feed(state_t& s, const char*& ptr, const char* ptr_end, Context& ctx) {
+        const stream_status_t status = run(s, ptr, ptr_end, false, ctx);
+        if (status == stream_status_t::DONE) {
+            if (s.pos > s.carry_len) ptr += s.pos - s.carry_len;
+        } else if (status == stream_status_t::MORE) {
+            const uint32_t n = static_cast<uint32_t>(ptr_end - ptr);
+            if (n > carry_size - s.carry_len) return stream_status_t::FAIL;
+            if (n) std::memcpy(s.carry + s.carry_len, ptr, n);
+            s.carry_len += n;
+            ptr = ptr_end;
+        }
+        return status;
+    }
+
+    // end of input: whatever is pending is parsed as the end of the string
+    static inline stream_status_t finish(state_t& s, Context& ctx) {
+        return run(s, s.carry + s.carry_len, s.carry + s.carry_len, true, ctx);
+    }
+
+private:
+    static inline stream_status_t run(state_t& s, const char* ptr, const char* ptr_end, bool last, Context& ctx) {
+        const uint32_t carry_len = s.carry_len;
+        const uint32_t avail = carry_len + static_cast<uint32_t>(ptr_end - ptr);
+        const char* const carry = s.carry;
+        auto at = [&](uint32_t pos) { return pos < carry_len ? carry[pos] : ptr[pos - carry_len]; };
+        for (;;) {
+            const instruction_t<Context>& in = code::code[s.pc];
+            switch (in.op) {
+            case opcode_t::CHAR:
+                if (s.pos == avail) {
+                    if (!last) return stream_status_t::MORE;
+                    break;
+                }
+                if (at(s.pos) == in.arg) {
+                    if (in.action && !in.action(in.arg, 1, ctx)) break;
+                    ++s.pos;
+                    ++s.pc;
+                    continue;
+                }
+                break;
+            case opcode_t::NUMBER:
+            case opcode_t::VAR_NUMBER: {
+                const uint32_t max = static_cast<uint32_t>(in.arg);
+                bool stop = false;
+                while (s.digits < max) {
+                    if (s.pos == avail) {
+                        if (!last) return stream_status_t::MORE;
+                        stop = true;
+                        break;
+                    }
+                    const unsigned digit = static_cast<unsigned>(at(s.pos) - '0');
+                    if (digit > 9) {
+                        stop = true;
+                        break;
+                    }
+                    s.value = s.value * 10 + static_cast<int32_t>(digit);
+                    ++s.digits;
+                    ++s.pos;
+                }
+                const int32_t value = s.value;
+                const uint32_t digits = s.digits;
+                s.value = 0;
+                s.digits = 0;
+                if (stop && (in.op == opcode_t::NUMBER || !digits)) break;
+                if (!in.action(value, static_cast<int>(digits), ctx)) break;
+                ++s.pc;
+                continue;
+            }
+            case opcode_t::KEYWORD: {
+                const uint32_t width = static_cast<uint32_t>(in.arg);
+                bool stop = false;
+                while (s.digits < width) {
+                    if (s.pos == avail) {
+                        if (!last) return stream_status_t::MORE;
+                        stop = true;
+                        break;
+                    }
+                    s.value = static_cast<int32_t>(static_cast<uint32_t>(s.value) << 8 | (static_cast<uint8_t>(at(s.pos)) | 0x20));
+                    ++s.digits;
+                    ++s.pos;
+                }
+                const int32_t key = s.value;
+                s.value = 0;
+                s.digits = 0;
+                if (stop || !in.action(key, in.arg, ctx)) break;
+                ++s.pc;
+                continue;
+            }
+            case opcode_t::CHOICE:
+                s.stack[s.top++] = frame_t{s.pc + in.jump, s.pos};
+                ++s.pc;
+                continue;
+            case opcode_t::COMMIT:
+                --s.top;
+                s.pc += in.jump;
+                continue;
+            case opcode_t::ACCEPT:
+                return stream_status_t::DONE;
+            }
+            // failure: resume the most recent pending alternative
+            if (!s.top) return stream_status_t::FAIL;
+            --s.top;
+            s.pc = s.stack[s.top].pc;
+            s.pos = s.stack[s.top].pos;
+        }
+    }
+};
+
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdlib>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+#include "iso8601.hpp"
+
+// Per node grammar counters: traced<G, trace_on> is G with every node wrapped
+// in a probe which counts, into thread-local counters of its own, the attempts,
+// the successes, the failures and the bytes rescanned, i.e. the bytes its
+// sub-nodes had matched before it failed and which the next alternative reads
+// again. The probes keep nullable() and first(), so the op_or dispatch is the
+// same as G's. traced<G, trace_off> is G itself, the default policy is trace_on
+// when built with LAZY_TRACE=1 and trace_off otherwise:
+//
+//   using G = traced<grammar_generic>;
+//   G::parse(...);
+//   trace_of<G>::report(std::cout);                // nothing when disabled
+//
+// Wrap the other rewrites, traced<validated<G>>, not the other way round.
+
+#ifndef LAZY_TRACE
+#define LAZY_TRACE 0
+#endif
+
+namespace parser {
+
+struct trace_stats_t {
+    uint64_t attempts;
+    uint64_t successes;
+    uint64_t failures;
+    uint64_t rescanned;
+};
+
+// how far the sub-nodes of the running probe got
+struct trace_state {
+    static inline const char*& furthest() {
+        static thread_local const char* value = nullptr;
+        return value;
+    }
+};
+
+// position of a node in the tree, one probe and counters per position
+template <typename Parent, std::size_t I> struct trace_path {};
+
+template <typename T> inline std::string trace_type_name() {
+    std::string name = typeid(T).name();
+#if defined(__GNUC__)
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (demangled) {
+        name = demangled;
+        std::free(demangled);
+    }
+#endif
+    for (std::size_t at; (at = name.find("parser::")) != std::string::npos;) name.erase(at, 8);
+    return name;
+}
+
+template <typename T> struct trace_name {
+    static std::string get() { return trace_type_name<T>(); }
+};
+template <char C> struct trace_name<term_char<C, void>> {
+    static std::string get() { return std::string("'") + C + "'"; }
+};
+template <char C, typename Handler> struct trace_name<term_char<C, Handler>> {
+    static std::string get() { return std::string("'") + C + "' " + trace_type_name<Handler>(); }
+};
+template <int N, typename Handler> struct trace_name<term_number<N, Handler>> {
+    static std::string get() { return "number<" + std::to_string(N) + "> " + trace_type_name<Handler>(); }
+};
+template <int N, typename Handler> struct trace_name<term_var_number<N, Handler>> {
+    static std::string get() { return "var_number<" + std::to_string(N) + "> " + trace_type_name<Handler>(); }
+};
+template <typename ...Ts> struct trace_name<op_seq<Ts...>> {
+    static std::string get() { return "seq"; }
+};
+template <typename ...Ts> struct trace_name<op_or<Ts...>> {
+    static std::string get() { return sizeof...(Ts) > 1 && is_ll1<Ts...>::value ? "or, by first byte" : "or"; }
+};
+template <typename ...Ts> struct trace_name<op_maybe<Ts...>> {
+    static std::string get() { return sizeof...(Ts) > 1 && is_ll1<Ts...>::value ? "maybe, by first byte" : "maybe"; }
+};
+
+// T is the original node, Inner the node with traced children, Children the
+// probes of those children
+template <typename T, typename Path, typename Inner, typename ...Children>
+struct probe {
+    static constexpr bool nullable() { return Inner::nullable(); }
+    static constexpr bool first(unsigned c) { return Inner::first(c); }
+
+    static inline trace_stats_t& stats() {
+        static thread_local trace_stats_t value {0, 0, 0, 0};
+        return value;
+    }
+
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        trace_stats_t& s = stats();
+        const char*& furthest = trace_state::furthest();
+        const char* outer = furthest;
+        furthest = ptr;
+        ++s.attempts;
+        const char* result = Inner::parse(ptr, ptr_end, ctx);
+        if (result) {
+            ++s.successes;
+            if (result > furthest) furthest = result;
+        } else {
+            ++s.failures;
+            s.rescanned += furthest - ptr;
+        }
+        if (outer > furthest) furthest = outer;
+        return result;
+    }
+
+    static void reset() {
+        stats() = trace_stats_t {0, 0, 0, 0};
+        (void)std::initializer_list<int>{(Children::reset(), 0)...};
+    }
+
+    static void report(std::ostream& os, int depth = 0) {
+        if (!depth) {
+            os << std::left << std::setw(60) << "node" << std::right << std::setw(12) << "attempts" << std::setw(12) << "successes"
+               << std::setw(12) << "failures" << std::setw(12) << "rescanned" << "\n";
+        }
+        const trace_stats_t& s = stats();
+        os << std::left << std::setw(60) << (std::string(depth * 2, ' ') + trace_name<T>::get()) << std::right
+           << std::setw(12) << s.attempts << std::setw(12) << s.successes << std::setw(12) << s.failures
+           << std::setw(12) << s.rescanned << "\n";
+        (void)std::initializer_list<int>{(Children::report(os, depth + 1), 0)...};
+    }
+};
+
+template <typename T, typename Path> struct trace_node { using type = probe<T, Path, T>; };
+template <typename T, typename Path> using traced_at = typename trace_node<T, Path>::type;
+
+template <typename T, typename Path, typename Indices> struct trace_op;
+template <template <typename...> class Op, typename ...Ts, typename Path, std::size_t... Is>
+struct trace_op<Op<Ts...>, Path, index_list<Is...>> {
+    using type = probe<Op<Ts...>, Path, Op<traced_at<Ts, trace_path<Path, Is>>...>, traced_at<Ts, trace_path<Path, Is>>...>;
+};
+
+template <typename ...Ts, typename Path> struct trace_node<op_seq<Ts...>, Path>
+    : trace_op<op_seq<Ts...>, Path, typename make_index_list<sizeof...(Ts)>::type> {};
+template <typename ...Ts, typename Path> struct trace_node<op_or<Ts...>, Path>
+    : trace_op<op_or<Ts...>, Path, typename make_index_list<sizeof...(Ts)>::type> {};
+template <typename ...Ts, typename Path> struct trace_node<op_maybe<Ts...>, Path>
+    : trace_op<op_maybe<Ts...>, Path, typename make_index_list<sizeof...(Ts)>::type> {};
+
+struct trace_off { template <typename G> using apply = G; };
+struct trace_on { template <typename G> using apply = traced_at<G, trace_path<void, 0>>; };
+using trace_default = std::conditional<LAZY_TRACE != 0, trace_on, trace_off>::type;
+
+template <typename G, typename Policy = trace_default> using traced = typename Policy::template apply<G>;
+
+static_assert(std::is_same<traced<grammar_generic, trace_off>, grammar_generic>::value, "trace_off must leave the grammar untouched");
+
+// report() and reset() of a traced grammar, no-ops for the untraced ones
+template <typename G> struct trace_of {
+    static void report(std::ostream&) {}
+    static void reset() {}
+};
+template <typename T, typename Path, typename Inner, typename ...Children>
+struct trace_of<probe<T, Path, Inner, Children...>> {
+    static void report(std::ostream& os) { probe<T, Path, Inner, Children...>::report(os); }
+    static void reset() { probe<T, Path, Inner, Children...>::reset(); }
+};
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <type_traits>
+#include "iso8601.hpp"
+
+namespace parser {
+
+// Range validation fused into the handlers: validated<G> is G with every
+// handler replaced by checked<Handler>, which tests the value against the
+// fields parsed so far before storing it and rejects it otherwise, so the term
+// fails right at the offending field. G itself is left untouched and costs
+// nothing extra.
+
+struct calendar {
+    static inline bool leap(int32_t year) { return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0); }
+
+    // month 0 (not parsed, e.g. ---DD) allows 31 days, a month past 12 none
+    static inline uint32_t days_in_month(int32_t year, uint32_t mon) {
+        static const uint8_t days[] = {31, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        if (mon > 12) return 0;
+        return days[mon] + (mon == 2 && leap(year));
+    }
+};
+
+// accepts any value unless specialized
+template <typename Handler> struct check {
+    template <typename Context>
+    static inline bool valid(int, const Context&) { return true; }
+};
+
+template <> struct check<handler_month> {
+    template <typename Context>
+    static inline bool valid(int value, const Context&) { return value >= 1 && value <= 12; }
+};
+template <> struct check<handler_day> {
+    template <typename Context>
+    static inline bool valid(int value, const Context& ctx) {
+        return value >= 1 && static_cast<uint32_t>(value) <= calendar::days_in_month(ctx.dt.year, ctx.dt.mon);
+    }
+};
+template <> struct check<handler_day_v>: check<handler_day> {};
+template <> struct check<handler_ordinal_date> {
+    template <typename Context>
+    static inline bool valid(int value, const Context& ctx) { return value >= 1 && value <= 365 + calendar::leap(ctx.dt.year); }
+};
+template <> struct check<handler_week> {
+    template <typename Context>
+    static inline bool valid(int value, const Context&) { return value >= 1 && value <= 53; }
+};
+template <> struct check<handler_week_day> {
+    template <typename Context>
+    static inline bool valid(int value, const Context&) { return value >= 1 && value <= 7; }
+};
+template <> struct check<handler_hour> {
+    template <typename Context>
+    static inline bool valid(int value, const Context&) { return value <= 23; }
+};
+template <> struct check<handler_hour_v>: check<handler_hour> {};
+template <> struct check<handler_minute> {
+    template <typename Context>
+    static inline bool valid(int value, const Context&) { return value <= 59; }
+};
+template <> struct check<handler_minute_v>: check<handler_minute> {};
+template <> struct check<handler_second> {
+    template <typename Context>
+    static inline bool valid(int value, const Context&) { return value <= 60; }      // leap second
+};
+template <> struct check<handler_second_v>: check<handler_second> {};
+template <> struct check<handler_tz_offset_hour>: check<handler_hour> {};
+template <> struct check<handler_tz_offset_minute>: check<handler_minute> {};
+
+template <typename Handler> struct checked {
+    template <typename Context>
+    static inline bool handle(int value, Context& ctx) {
+        if (!check<Handler>::valid(value, ctx)) return false;
+        Handler::handle(value, ctx);
+        return true;
+    }
+    template <typename Context>
+    static inline bool handle(int value, int count, Context& ctx) {
+        if (!check<Handler>::valid(value, ctx)) return false;
+        Handler::handle(value, count, ctx);
+        return true;
+    }
+};
+
+// every node needs a rewrite, so that wrapping never silently checks nothing
+template <typename T> struct validate {
+    static_assert(!std::is_same<T, T>::value, "validated<T>: no validate<> rewrite for this node");
+};
+template <typename T> using validated = typename validate<T>::type;
+
+// the handlers of chars only mark signs and zones, there is nothing to check
+template <char C, typename Handler> struct validate<term_char<C, Handler>> { using type = term_char<C, Handler>; };
+
+template <int N, typename Handler> struct validate<term_number<N, Handler>> {
+    using type = term_number<N, checked<Handler>>;
+};
+template <int N, typename Handler> struct validate<term_var_number<N, Handler>> {
+    using type = term_var_number<N, checked<Handler>>;
+};
+template <typename ...Ts> struct validate<op_seq<Ts...>> { using type = op_seq<validated<Ts>...>; };
+template <typename ...Ts> struct validate<op_or<Ts...>> { using type = op_or<validated<Ts>...>; };
+template <typename ...Ts> struct validate<op_maybe<Ts...>> { using type = op_maybe<validated<Ts>...>; };
+
+}
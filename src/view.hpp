@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include "iso8601.hpp"
+#include "epoch.hpp"
+
+namespace parser {
+
+// Lazy variant of the grammars: deferred<G> is G with every number and every
+// char with a handler replaced by a mark, which only checks the digits and
+// records where the field is, in a view_t used as the context. The fields are
+// decoded when read, through the same handlers as G, and two views in the same
+// canonical ISO layout ("YYYY-MM-DD[Thh:mm:ss[.f]][Z]") compare as raw bytes.
+// The view points into the input, which must outlive it.
+
+enum class slot_t : uint8_t {
+    YEAR_SIGN, YEAR, MONTH, DAY, ORDINAL, WEEK, WEEK_DAY, HOUR, MINUTE, SECOND, FRACTION,
+    TZ_UTC, TZ_SIGN, TZ_HOUR, TZ_MINUTE, COUNT
+};
+
+template <typename Handler> struct slot_of;
+template <slot_t S> struct slot_is: std::integral_constant<slot_t, S> {};
+template <> struct slot_of<handler_year_sign>: slot_is<slot_t::YEAR_SIGN> {};
+template <> struct slot_of<handler_year>: slot_is<slot_t::YEAR> {};
+template <> struct slot_of<handler_year_v>: slot_is<slot_t::YEAR> {};
+template <> struct slot_of<handler_month>: slot_is<slot_t::MONTH> {};
+template <> struct slot_of<handler_day>: slot_is<slot_t::DAY> {};
+template <> struct slot_of<handler_ordinal_date>: slot_is<slot_t::ORDINAL> {};
+template <> struct slot_of<handler_week>: slot_is<slot_t::WEEK> {};
+template <> struct slot_of<handler_week_day>: slot_is<slot_t::WEEK_DAY> {};
+template <> struct slot_of<handler_hour>: slot_is<slot_t::HOUR> {};
+template <> struct slot_of<handler_hour_v>: slot_is<slot_t::HOUR> {};
+template <> struct slot_of<handler_minute>: slot_is<slot_t::MINUTE> {};
+template <> struct slot_of<handler_minute_v>: slot_is<slot_t::MINUTE> {};
+template <> struct slot_of<handler_second>: slot_is<slot_t::SECOND> {};
+template <> struct slot_of<handler_second_v>: slot_is<slot_t::SECOND> {};
+template <> struct slot_of<handler_fraction>: slot_is<slot_t::FRACTION> {};
+template <> struct slot_of<handler_tz_utc>: slot_is<slot_t::TZ_UTC> {};
+template <> struct slot_of<handler_tz_offset_sign>: slot_is<slot_t::TZ_SIGN> {};
+template <> struct slot_of<handler_tz_offset_hour>: slot_is<slot_t::TZ_HOUR> {};
+template <> struct slot_of<handler_tz_offset_minute>: slot_is<slot_t::TZ_MINUTE> {};
+
+struct view_t {
+    struct field_t {
+        uint8_t offset;
+        uint8_t size;
+    };
+
+    const char* data;
+    uint16_t marks;                                 // a bit per slot
+    uint8_t length;                                 // of the match
+    uint8_t layout;                                 // canonical layout id, 0 if not canonical
+    field_t fields[static_cast<std::size_t>(slot_t::COUNT)];
+
+    view_t(): data(NULL), marks(0), length(0), layout(0), fields() {}
+
+    // the context side, called by the marks of deferred<G>; the input is cut
+    // to 255 bytes, so that the offsets fit
+    inline void mark(slot_t slot, const char* begin, const char* end) {
+        marks |= 1u << static_cast<unsigned>(slot);
+        fields[static_cast<std::size_t>(slot)] = field_t{static_cast<uint8_t>(begin - data), static_cast<uint8_t>(end - begin)};
+    }
+
+    inline bool has(slot_t slot) const { return marks & (1u << static_cast<unsigned>(slot)); }
+
+    // the digits of a field as written, 0 when absent
+    inline uint32_t number(slot_t slot) const {
+        if (!has(slot)) return 0;
+        const field_t& f = fields[static_cast<std::size_t>(slot)];
+        uint32_t value = 0;
+        for (const char* it = data + f.offset; it != data + f.offset + f.size; ++it) value = value * 10 + (*it - '0');
+        return value;
+    }
+
+    // what G would have stored in dt, field by field
+    inline int32_t year() const {
+        const int32_t value = static_cast<int32_t>(number(slot_t::YEAR));
+        return has(slot_t::YEAR_SIGN) && data[fields[static_cast<std::size_t>(slot_t::YEAR_SIGN)].offset] == '-' ? -value : value;
+    }
+    inline uint32_t month() const { return has(slot_t::ORDINAL) ? 0 : number(slot_t::MONTH); }
+    inline uint32_t day() const { return has(slot_t::ORDINAL) ? number(slot_t::ORDINAL) : number(slot_t::DAY); }
+    inline uint32_t hour() const { return number(slot_t::HOUR); }
+    // a fraction of the hour or of the minute spills over the smaller fields
+    inline uint32_t minute() const { return spills(slot_t::MINUTE) ? decoded().dt.min : number(slot_t::MINUTE); }
+    inline uint32_t second() const { return spills(slot_t::SECOND) ? decoded().dt.sec : number(slot_t::SECOND); }
+
+    // every field through the handlers of G, in the order of the layouts;
+    // ctx is expected to be initialized as for G
+    template <typename Context>
+    inline void decode(Context& ctx) const {
+        for (unsigned s = 0; s < static_cast<unsigned>(slot_t::COUNT); ++s) {
+            if (!(marks & (1u << s))) continue;
+            const slot_t slot = static_cast<slot_t>(s);
+            const field_t& f = fields[s];
+            const int value = static_cast<int>(number(slot));
+            switch (slot) {
+            case slot_t::YEAR_SIGN: handler_year_sign::handle(data[f.offset], ctx); break;
+            case slot_t::YEAR:      handler_year_v::handle(value, f.size, ctx); break;
+            case slot_t::MONTH:     handler_month::handle(value, ctx); break;
+            case slot_t::DAY:       handler_day::handle(value, ctx); break;
+            case slot_t::ORDINAL:   handler_ordinal_date::handle(value, ctx); break;
+            case slot_t::WEEK:      handler_week::handle(value, ctx); break;
+            case slot_t::WEEK_DAY:  handler_week_day::handle(value, ctx); break;
+            case slot_t::HOUR:      handler_hour::handle(value, ctx); break;
+            case slot_t::MINUTE:    handler_minute::handle(value, ctx); break;
+            case slot_t::SECOND:    handler_second::handle(value, ctx); break;
+            case slot_t::FRACTION:  handler_fraction::handle(value, f.size, ctx); break;
+            case slot_t::TZ_UTC:    handler_tz_utc::handle(data[f.offset], ctx); break;
+            case slot_t::TZ_SIGN:   handler_tz_offset_sign::handle(data[f.offset], ctx); break;
+            case slot_t::TZ_HOUR:   handler_tz_offset_hour::handle(value, ctx); break;
+            case slot_t::TZ_MINUTE: handler_tz_offset_minute::handle(value, ctx); break;
+            case slot_t::COUNT:     break;
+            }
+        }
+    }
+
+    inline value_context_t decoded() const {
+        value_context_t ctx = value_context_t::local();
+        decode(ctx);
+        return ctx;
+    }
+
+    inline epoch_t epoch() const { return civil::to_epoch(decoded()); }
+
+    // raw bytes when both are in the same canonical layout, the epochs otherwise
+    static inline int compare(const view_t& a, const view_t& b) {
+        if (a.layout && a.layout == b.layout) return bytes(a.data, b.data, a.length);
+        const epoch_t x = a.epoch(), y = b.epoch();
+        return (x > y) - (x < y);
+    }
+
+    // memcmp, 8 bytes per step: most pairs differ within the first 16
+    static inline int bytes(const char* a, const char* b, std::size_t n) {
+        for (; n >= 8; a += 8, b += 8, n -= 8) {
+            uint64_t x, y;
+            std::memcpy(&x, a, 8);
+            std::memcpy(&y, b, 8);
+            if (x != y) return std::memcmp(a, b, 8);
+        }
+        return n ? std::memcmp(a, b, n) : 0;
+    }
+
+    // YYYY-MM-DD[(T| )hh:mm:ss[.f{1,9}]][Z], the id tells the length, the time
+    // separator and Z apart, so equal ids sort as bytes. The digits were checked
+    // by the marks, so the marks and the separators at their places are enough.
+    inline void classify() {
+        layout = 0;
+        const unsigned date = bit(slot_t::YEAR) | bit(slot_t::MONTH) | bit(slot_t::DAY);
+        const unsigned time = bit(slot_t::HOUR) | bit(slot_t::MINUTE) | bit(slot_t::SECOND);
+        const unsigned utc = has(slot_t::TZ_UTC);
+        unsigned end = 10, expected = date;
+        if (marks & time) {
+            end = 19;
+            expected |= time;
+            if (has(slot_t::FRACTION)) {
+                end = length - utc;
+                expected |= bit(slot_t::FRACTION);
+            }
+        }
+        if (utc) expected |= bit(slot_t::TZ_UTC);
+        if (marks != expected || end + utc != length || data[4] != '-' || data[7] != '-') return;
+        if (end > 10 && ((data[10] != 'T' && data[10] != ' ') || data[13] != ':' || data[16] != ':')) return;
+        if (end > 19 && (end < 21 || data[19] != '.')) return;
+        layout = static_cast<uint8_t>(length | (end > 10 && data[10] == ' ' ? 64 : 0) | (utc ? 128 : 0));
+    }
+
+private:
+    static inline uint16_t bit(slot_t slot) { return static_cast<uint16_t>(1u << static_cast<unsigned>(slot)); }
+
+    inline bool spills(slot_t slot) const {
+        return has(slot_t::FRACTION) && !has(slot);
+    }
+};
+
+inline bool operator<(const view_t& a, const view_t& b) { return view_t::compare(a, b) < 0; }
+
+// 1 to N digits, as term_var_number
+template <int Min, int Max, typename Handler>
+struct term_mark {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return c >= '0' && c <= '9'; }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        const char* number_end = std::min(ptr + Max, ptr_end);
+        const char* it = ptr;
+        while (it != number_end && static_cast<unsigned>(*it - '0') <= 9) ++it;
+        if (it - ptr < Min) return NULL;
+        ctx.mark(slot_of<Handler>::value, ptr, it);
+        return it;
+    }
+};
+
+// exactly N digits, as term_number
+template <int N, typename Handler>
+struct term_mark<N, N, Handler> {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return c >= '0' && c <= '9'; }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        if (ptr_end - ptr < N) return NULL;
+        for (int i = 0; i < N; ++i) {
+            if (static_cast<unsigned>(ptr[i] - '0') > 9) return NULL;
+        }
+        ctx.mark(slot_of<Handler>::value, ptr, ptr + N);
+        return ptr + N;
+    }
+};
+
+template <char T, typename Handler>
+struct term_mark_char {
+    static constexpr bool nullable() { return false; }
+    static constexpr bool first(unsigned c) { return c == static_cast<unsigned char>(T); }
+    template <typename Context>
+    static inline const char* parse(const char* ptr, const char* ptr_end, Context& ctx) {
+        if (ptr - ptr_end == 0 || *ptr != T) return NULL;
+        ctx.mark(slot_of<Handler>::value, ptr, ptr + 1);
+        return ptr + 1;
+    }
+};
+
+template <typename T> struct defer { using type = T; };
+template <typename T> using deferred = typename defer<T>::type;
+
+template <int N, typename Handler> struct defer<term_number<N, Handler>> { using type = term_mark<N, N, Handler>; };
+template <int N, typename Handler> struct defer<term_var_number<N, Handler>> { using type = term_mark<1, N, Handler>; };
+template <char T, typename Handler> struct defer<term_char<T, Handler>> { using type = term_mark_char<T, Handler>; };
+template <char T> struct defer<term_char<T, void>> { using type = term_char<T, void>; };
+template <typename ...Ts> struct defer<op_seq<Ts...>> { using type = op_seq<deferred<Ts>...>; };
+template <typename ...Ts> struct defer<op_or<Ts...>> { using type = op_or<deferred<Ts>...>; };
+template <typename ...Ts> struct defer<op_maybe<Ts...>> { using type = op_maybe<deferred<Ts>...>; };
+
+// bytes to a view in one call, like epoch<G>; the view is written on success only
+template <typename G>
+struct view {
+    static inline const char* parse(const char* ptr, const char* ptr_end, view_t& out) {
+        view_t v;
+        v.data = ptr;
+        const char* result = deferred<G>::parse(ptr, ptr_end - ptr > 255 ? ptr + 255 : ptr_end, v);
+        if (!result) return NULL;
+        v.length = static_cast<uint8_t>(result - ptr);
+        v.classify();
+        out = v;
+        return result;
+    }
+};
+
+}
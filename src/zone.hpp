@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "epoch.hpp"
+
+namespace parser {
+
+// A time zone loaded once from a TZif file (RFC 8536) into sorted arrays of
+// transitions, so that LOCAL results of the grammars are turned into UTC, and
+// UTC values into wall clock fields for formatting, without mktime and its
+// global lock: a binary search at worst, no libc call and no syscall.
+// The POSIX rule of the footer is expanded at load time up to last_year, later
+// times keep the last offset.
+//
+// Lookups may run on any number of threads at once, load_*() may not. Each
+// direction keeps its last hit in a relaxed atomic, written on misses only, so
+// mostly sorted input skips the search.
+struct zone_t {
+    static const int32_t last_year = 2200;
+
+    zone_t(): utc_hint{0}, local_hint{0} {
+        reset(0);
+        seal();
+    }
+
+    // a name below $TZDIR (/usr/share/zoneinfo by default), or a path
+    bool load_file(const char* name) {
+        std::string path = name;
+        if (name[0] != '/' && name[0] != '.') {
+            const char* dir = std::getenv("TZDIR");
+            path = std::string(dir ? dir : "/usr/share/zoneinfo") + "/" + name;
+        }
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        std::vector<char> data;
+        char buff[4096];
+        std::size_t n;
+        while ((n = std::fread(buff, 1, sizeof(buff), f)) > 0) data.insert(data.end(), buff, buff + n);
+        std::fclose(f);
+        return load(data.data(), data.size());
+    }
+
+    // a TZif image, version 1 to 4; leap second records are ignored
+    bool load(const char* data, std::size_t size) {
+        const unsigned char* ptr = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* ptr_end = ptr + size;
+        header_t h;
+        if (!header(ptr, ptr_end, h)) return false;
+        if (h.version >= '2') {
+            ptr += h.block(4);                          // the 32-bit block comes first, for older readers
+            if (!header(ptr, ptr_end, h)) return false;
+            return block(ptr, ptr_end, h, 8);
+        }
+        return block(ptr, ptr_end, h, 4);
+    }
+
+    // a POSIX TZ string such as "CET-1CEST,M3.5.0,M10.5.0/3", expanded from 1970 on
+    bool load_rule(const char* text) {
+        rule_t rule;
+        if (!parse_rule(text, rule)) return false;
+        reset(rule.std_offset);
+        expand(rule);
+        return seal();
+    }
+
+    // seconds east of UTC at a UTC time
+    inline int32_t offset(int64_t seconds) const {
+        return offsets[find(utc, utc_hint, seconds)];
+    }
+
+    // UTC seconds of a wall clock time: a time which occurs twice is taken the
+    // first time, a time skipped over is moved forward by the gap
+    inline int64_t to_utc(int64_t seconds) const {
+        const uint32_t i = find(local, local_hint, seconds);
+        const int32_t o = offsets[i];
+        return seconds - (seconds - o < utc[i] ? offsets[i - 1] : o);
+    }
+
+    // civil::to_epoch with LOCAL times taken in this zone instead of UTC
+    template <typename Context>
+    inline epoch_t to_epoch(const Context& ctx) const {
+        const epoch_t value = civil::to_epoch(ctx);
+        if (ctx.tz.tz_info != tz_info_t::LOCAL) return value;
+        const int64_t seconds = value / 1000000 - (value % 1000000 < 0);
+        return value + (to_utc(seconds) - seconds) * 1000000;
+    }
+
+    // wall clock fields and offset of a UTC time, e.g. for expression_t;
+    // tz drops the seconds of the offset, which only local mean times have
+    inline void to_local(epoch_t value, datetime& dt, microsec_t& mksec, timezone_t& tz) const {
+        const int32_t o = offset(value / 1000000 - (value % 1000000 < 0));
+        civil::from_epoch(value + static_cast<int64_t>(o) * 1000000, dt, mksec);
+        const uint32_t abs = static_cast<uint32_t>(o < 0 ? -o : o);
+        tz = timezone_t{tz_info_t::UTC, o < 0 ? -1 : 1, abs / 3600, abs / 60 % 60};
+    }
+
+    // transitions, the sentinels excluded
+    std::size_t size() const { return utc.size() - 2; }
+
+private:
+    struct header_t {
+        char version;
+        uint32_t isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt;
+
+        std::size_t block(std::size_t time_size) const {
+            return timecnt * (time_size + 1) + typecnt * 6 + charcnt + leapcnt * (time_size + 4) + isstdcnt + isutcnt;
+        }
+    };
+
+    // a date of a POSIX rule: Jn (1-365, no Feb 29), n (0-365) or Mm.w.d,
+    // time is the wall clock seconds of the transition on that day
+    struct date_t {
+        char kind;
+        int32_t n, m, w, d;
+        int32_t time;
+    };
+
+    struct rule_t {
+        int32_t std_offset;
+        int32_t dst_offset;
+        bool dst;
+        date_t start, end;
+    };
+
+    static inline uint32_t be32(const unsigned char* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+    static inline uint64_t be64(const unsigned char* p) { return (uint64_t(be32(p)) << 32) | be32(p + 4); }
+
+    static bool header(const unsigned char*& ptr, const unsigned char* ptr_end, header_t& h) {
+        if (ptr_end - ptr < 44 || std::memcmp(ptr, "TZif", 4)) return false;
+        h.version = static_cast<char>(ptr[4]);
+        h.isutcnt = be32(ptr + 20);
+        h.isstdcnt = be32(ptr + 24);
+        h.leapcnt = be32(ptr + 28);
+        h.timecnt = be32(ptr + 32);
+        h.typecnt = be32(ptr + 36);
+        h.charcnt = be32(ptr + 40);
+        ptr += 44;
+        return h.typecnt > 0 && h.block(4) <= static_cast<std::size_t>(ptr_end - ptr);
+    }
+
+    bool block(const unsigned char* ptr, const unsigned char* ptr_end, const header_t& h, std::size_t time_size) {
+        const unsigned char* times = ptr;
+        const unsigned char* indices = times + h.timecnt * time_size;
+        const unsigned char* types = indices + h.timecnt;
+        if (static_cast<std::size_t>(ptr_end - ptr) < h.block(time_size)) return false;
+        // times before the first transition are in the first type
+        reset(static_cast<int32_t>(be32(types)));
+        for (uint32_t i = 0; i < h.timecnt; ++i) {
+            if (indices[i] >= h.typecnt) return false;
+            const int64_t at = time_size == 8 ? static_cast<int64_t>(be64(times + i * 8))
+                                              : static_cast<int32_t>(be32(times + i * 4));
+            if (at <= utc.back()) return false;
+            add(at, static_cast<int32_t>(be32(types + indices[i] * 6)));
+        }
+        // the footer, "\n<POSIX TZ string>\n", for the times after the last transition
+        const unsigned char* footer = ptr + h.block(time_size);
+        if (time_size == 8 && footer < ptr_end && *footer == '\n') {
+            const unsigned char* eol = static_cast<const unsigned char*>(std::memchr(footer + 1, '\n', ptr_end - footer - 1));
+            if (eol && eol > footer + 1) {
+                rule_t rule;
+                const std::string text(footer + 1, eol);
+                if (!parse_rule(text.c_str(), rule)) return false;
+                expand(rule);
+            }
+        }
+        return seal();
+    }
+
+    void reset(int32_t initial) {
+        utc.assign(1, INT64_MIN);
+        local.assign(1, INT64_MIN);
+        offsets.assign(1, initial);
+    }
+
+    // local is the wall clock before the transition
+    void add(int64_t at, int32_t offset) {
+        utc.push_back(at);
+        local.push_back(at + offsets.back());
+        offsets.push_back(offset);
+    }
+
+    bool seal() {
+        utc.push_back(INT64_MAX);
+        local.push_back(INT64_MAX);
+        offsets.push_back(offsets.back());
+        utc_hint.store(0, std::memory_order_relaxed);
+        local_hint.store(0, std::memory_order_relaxed);
+        return std::is_sorted(local.begin(), local.end());
+    }
+
+    // keys[i] <= value < keys[i + 1], between the sentinels
+    static inline uint32_t find(const std::vector<int64_t>& keys, std::atomic<uint32_t>& hint, int64_t value) {
+        const uint32_t last = hint.load(std::memory_order_relaxed);
+        if (keys[last] <= value && value < keys[last + 1]) return last;
+        // branchless, the comparisons of random input are unpredictable
+        const int64_t* base = keys.data();
+        std::size_t n = keys.size() - 1;
+        while (n > 1) {
+            const std::size_t half = n / 2;
+            base = base[half] <= value ? base + half : base;
+            n -= half;
+        }
+        const uint32_t i = static_cast<uint32_t>(base - keys.data());
+        hint.store(i, std::memory_order_relaxed);
+        return i;
+    }
+
+    // transitions of the rule from the year of the last one (or 1970) on
+    void expand(const rule_t& rule) {
+        if (!rule.dst) {
+            if (utc.size() == 1) offsets[0] = rule.std_offset;
+            return;
+        }
+        int32_t year = 1970;
+        if (utc.size() > 1) {
+            uint32_t m, d;
+            const int64_t s = utc.back();
+            civil::civil_from_days(s / 86400 - (s % 86400 < 0), year, m, d);
+        }
+        for (; year <= last_year; ++year) {
+            const int64_t start = day_of(rule.start, year) * 86400 + rule.start.time - rule.std_offset;
+            const int64_t end = day_of(rule.end, year) * 86400 + rule.end.time - rule.dst_offset;
+            if (start < end) {
+                next(start, rule.dst_offset);
+                next(end, rule.std_offset);
+            } else {                                    // southern hemisphere
+                next(end, rule.std_offset);
+                next(start, rule.dst_offset);
+            }
+        }
+    }
+
+    void next(int64_t at, int32_t offset) {
+        if (at > utc.back() && offset != offsets.back()) add(at, offset);
+    }
+
+    static int64_t day_of(const date_t& date, int32_t year) {
+        const int64_t jan1 = civil::days_from_civil(year, 1, 1);
+        if (date.kind == 'J') {
+            const bool leap = civil::days_from_civil(year, 3, 1) - jan1 == 60;
+            return jan1 + date.n - 1 + (leap && date.n >= 60);
+        }
+        if (date.kind == 'D') return jan1 + date.n;
+        // day d (0 = Sunday) of week w (5 = the last one) of month m
+        const int64_t first = civil::days_from_civil(year, date.m, 1);
+        const int64_t next_month = date.m == 12 ? civil::days_from_civil(year + 1, 1, 1) : civil::days_from_civil(year, date.m + 1, 1);
+        int64_t day = first + (date.d - static_cast<int32_t>(civil::week_day(first) % 7) + 7) % 7 + (date.w - 1) * 7;
+        while (day >= next_month) day -= 7;
+        return day;
+    }
+
+    // std offset [dst [offset] [,start[/time],end[/time]]], POSIX offsets are west of UTC
+    static bool parse_rule(const char* p, rule_t& rule) {
+        int32_t value;
+        if (!name(p) || !hms(p, value)) return false;
+        rule.std_offset = -value;
+        rule.dst = *p != 0;
+        if (!rule.dst) return true;
+        if (!name(p)) return false;
+        rule.dst_offset = rule.std_offset + 3600;
+        if (*p && *p != ',') {
+            if (!hms(p, value)) return false;
+            rule.dst_offset = -value;
+        }
+        if (!*p) p = ",M3.2.0,M11.1.0";                 // the POSIX default, US rules
+        if (*p++ != ',' || !date(p, rule.start) || *p++ != ',' || !date(p, rule.end)) return false;
+        return *p == 0;
+    }
+
+    static bool name(const char*& p) {
+        const char* start = p;
+        if (*p == '<') {
+            while (*p && *p != '>') ++p;
+            if (*p++ != '>') return false;
+            return p - start > 2;
+        }
+        while ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z')) ++p;
+        return p - start >= 3;
+    }
+
+    static bool number(const char*& p, int32_t& value) {
+        if (*p < '0' || *p > '9') return false;
+        value = 0;
+        while (*p >= '0' && *p <= '9' && value < 1000) value = value * 10 + (*p++ - '0');
+        return true;
+    }
+
+    // [+-]h[:mm[:ss]] in seconds
+    static bool hms(const char*& p, int32_t& value) {
+        const int32_t sign = *p == '-' ? -1 : 1;
+        if (*p == '+' || *p == '-') ++p;
+        int32_t h, m = 0, s = 0;
+        if (!number(p, h)) return false;
+        if (*p == ':' && !number(++p, m)) return false;
+        if (*p == ':' && !number(++p, s)) return false;
+        value = sign * (h * 3600 + m * 60 + s);
+        return true;
+    }
+
+    static bool date(const char*& p, date_t& date) {
+        date.kind = *p;
+        date.time = 2 * 3600;
+        if (*p == 'J') {
+            if (!number(++p, date.n) || date.n < 1 || date.n > 365) return false;
+        } else if (*p == 'M') {
+            if (!number(++p, date.m) || *p++ != '.' || !number(p, date.w) || *p++ != '.' || !number(p, date.d)) return false;
+            if (date.m < 1 || date.m > 12 || date.w < 1 || date.w > 5 || date.d > 6) return false;
+        } else {
+            date.kind = 'D';
+            if (!number(p, date.n) || date.n > 365) return false;
+        }
+        if (*p == '/' && !hms(++p, date.time)) return false;
+        return true;
+    }
+
+    std::vector<int64_t> utc;                       // transitions, INT64_MIN and INT64_MAX sentinels at the ends
+    std::vector<int64_t> local;                     // the same on the wall clock, before each transition
+    std::vector<int32_t> offsets;                   // seconds east of UTC, from each transition on
+    mutable std::atomic<uint32_t> utc_hint;
+    mutable std::atomic<uint32_t> local_hint;
+};
+
+}